@@ -0,0 +1,473 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sysmon.h"
+#include "meminfo.h"
+#include "cpu.h"
+#include "disk.h"
+#include "net.h"
+#include "proc.h"
+#include "cgroup.h"
+
+#define BENCH_MIN_NS 200000000L // run each case for at least 200 ms
+#define SYNTH_CPUS   512
+#define SYNTH_IFACES 5000
+
+typedef struct {
+    char *buf;
+    size_t len;
+} fixture_t;
+
+typedef void (*bench_fn_t)(void *arg);
+
+typedef struct {
+    cpu_cores_t current;
+    cpu_cores_t last;
+    float usage[CPU_MAX_CORES];
+} cpu_bench_t;
+
+typedef struct {
+    fixture_t *fixture;
+    disk_table_t disks;
+    int fullScan;
+} disk_bench_t;
+
+typedef struct {
+    fixture_t *fixture;
+    net_table_t net;
+    int fullScan;
+} net_bench_t;
+
+// glibc's own entry points, the wrappers below count every call
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static unsigned long allocs;
+
+
+/* ========================================================================
+ = MALLOC, CALLOC, REALLOC
+ =
+ = Count allocations made by the code under test
+ ======================================================================= */
+
+void *malloc(size_t size) {
+    allocs++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    allocs++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    allocs++;
+    return __libc_realloc(ptr, size);
+}
+
+
+/* ========================================================================
+ = NOW_NS
+ =
+ = Monotonic clock in nanoseconds
+ ======================================================================= */
+
+static long long nowNs(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+/* ========================================================================
+ = LOAD_FIXTURE
+ =
+ = Read a captured file into memory, name is relative to the fixture root
+ = like "proc/stat", returns -1 if missing
+ ======================================================================= */
+
+static int loadFixture(const char *root, const char *name, fixture_t *fixture) {
+    char path[512];
+    FILE *file;
+    long size;
+
+    snprintf(path, sizeof(path), "%s/%s", root, name);
+    if ((file = fopen(path, "r")) == NULL)
+        return -1;
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    rewind(file);
+
+    fixture->buf = malloc(size + 1);
+    fixture->len = fread(fixture->buf, 1, size, file);
+    fixture->buf[fixture->len] = '\0';
+    fclose(file);
+
+    return 0;
+}
+
+
+/* ========================================================================
+ = SYNTH_STAT
+ =
+ = Build a /proc/stat with the given number of busy cores
+ ======================================================================= */
+
+static void synthStat(int cpus, unsigned int seed, fixture_t *fixture) {
+    size_t size = (cpus + 2) * 128;
+    char *p;
+
+    p = fixture->buf = malloc(size);
+    p += sprintf(p, "cpu  %u %u %u %u 0 0 0 0 0 0\n", seed * cpus, seed, seed * 2, seed * 5 * cpus);
+    for (int i = 0; i < cpus; i++) {
+        unsigned int v = seed * (i + 1);
+        p += sprintf(p, "cpu%d %u %u %u %u %u %u %u %u 0 0\n",
+            i, 1234567 + v * 3, 89 + v, 345678 + v, 98765432 + v * 7, 12345 + v, 0, 2345 + v, v / 3);
+    }
+    p += sprintf(p, "intr 1 0 0\nctxt 123456789\nbtime 1500000000\nprocesses 424242\n");
+    p += sprintf(p, "procs_running 3\nprocs_blocked 0\nsoftirq 1 0 0\n");
+    fixture->len = p - fixture->buf;
+}
+
+
+/* ========================================================================
+ = SYNTH_NETDEV
+ =
+ = Build a /proc/net/dev of a Kubernetes node, a few uplinks and a veth
+ = plus calico interface for every pod
+ ======================================================================= */
+
+static void synthNetdev(int interfaces, fixture_t *fixture) {
+    static const char *uplinks[] = { "lo", "eth0", "eth1", "bond0", "docker0", "vxlan.calico" };
+    int count = sizeof(uplinks) / sizeof(uplinks[0]);
+    char *p;
+
+    p = fixture->buf = malloc((interfaces + 2) * 200);
+    p += sprintf(p, "Inter-|   Receive                                                |  Transmit\n");
+    p += sprintf(p, " face |bytes    packets errs drop fifo frame compressed multicast"
+        "|bytes    packets errs drop fifo colls carrier compressed\n");
+
+    for (int i = 0; i < interfaces; i++) {
+        char name[NET_NAME_LEN];
+
+        if (i < count)
+            snprintf(name, sizeof(name), "%s", uplinks[i]);
+        else
+            snprintf(name, sizeof(name), "%s%011x", i % 2 ? "cali" : "veth", i * 2654435761U);
+
+        p += sprintf(p, "%6s: %llu %d 0 0 0 0 0 %d %llu %d 0 0 0 0 0 0\n", name,
+            123456789ULL * (i + 1), 100000 + i, i % 7, 987654321ULL * (i + 3), 200000 + i);
+    }
+    fixture->len = p - fixture->buf;
+}
+
+
+/* ========================================================================
+ = BENCH_RUN
+ =
+ = Time a case, doubling the iteration count until it runs long enough.
+ = Allocations are counted over the final round only.
+ ======================================================================= */
+
+static void benchRun(const char *root, const char *name, bench_fn_t fn, void *arg) {
+    long long start, elapsed;
+    long iterations = 1;
+
+    while (1) {
+        allocs = 0;
+        start = nowNs();
+        for (long i = 0; i < iterations; i++)
+            fn(arg);
+        elapsed = nowNs() - start;
+
+        if (elapsed >= BENCH_MIN_NS)
+            break;
+        iterations *= 2;
+    }
+
+    printf("%-24s %-16s %10.1f ns/op %8.2f allocs/op  (%ld iterations)\n",
+        root, name, (double)elapsed / iterations, (double)allocs / iterations, iterations);
+}
+
+
+/* ========================================================================
+ = BENCH_MEMINFO
+ ======================================================================= */
+
+static void benchMeminfo(void *arg) {
+    fixture_t *fixture = arg;
+    meminfo_t info;
+
+    if (parseMeminfo(fixture->buf, fixture->len, &info) < 0) {
+        fprintf(stderr, "Failed to parse meminfo fixture!\n");
+        exit(1);
+    }
+}
+
+
+/* ========================================================================
+ = BENCH_STAT
+ ======================================================================= */
+
+static void benchStat(void *arg) {
+    fixture_t *fixture = arg;
+    static cpu_cores_t cores;
+    proc_stat_t stat;
+
+    if (parseStat(fixture->buf, fixture->len, &stat, &cores) < 0) {
+        fprintf(stderr, "Failed to parse stat fixture!\n");
+        exit(1);
+    }
+}
+
+
+/* ========================================================================
+ = BENCH_CPU_DELTA
+ ======================================================================= */
+
+static void benchCpuDelta(void *arg) {
+    cpu_bench_t *cpu = arg;
+
+    cpuCoreUsage(&cpu->current, &cpu->last, cpu->usage);
+}
+
+
+/* ========================================================================
+ = BENCH_DISKSTATS
+ ======================================================================= */
+
+static void benchDiskstats(void *arg) {
+    disk_bench_t *disk = arg;
+
+    // steady state excludes the periodic rescan, it is measured on its own
+    disk->disks.ticks = disk->fullScan ? DISK_RESCAN_TICKS : 0;
+    diskWeighted(&disk->disks, disk->fixture->buf, disk->fixture->len);
+}
+
+
+/* ========================================================================
+ = BENCH_NETDEV
+ ======================================================================= */
+
+static void benchNetdev(void *arg) {
+    net_bench_t *net = arg;
+    net_bytes_t bytes;
+
+    // steady state excludes the periodic rescan, it is measured on its own
+    net->net.ticks = net->fullScan ? NET_RESCAN_TICKS : 0;
+    netBytes(&net->net, net->fixture->buf, net->fixture->len, &bytes);
+}
+
+
+/* ========================================================================
+ = BENCH_LOADAVG
+ ======================================================================= */
+
+static void benchLoadAvg(void *arg) {
+    fixture_t *fixture = arg;
+    float load[3];
+
+    if (parseLoadAvg(fixture->buf, load) < 0) {
+        fprintf(stderr, "Failed to parse loadavg fixture!\n");
+        exit(1);
+    }
+}
+
+
+/* ========================================================================
+ = BENCH_CGROUP_CPU
+ ======================================================================= */
+
+static void benchCgroupCpu(void *arg) {
+    fixture_t *fixture = arg;
+    cgroup_cpu_t cpu;
+
+    if (parseCgroupCpu(fixture->buf, &cpu) < 0) {
+        fprintf(stderr, "Failed to parse cpu.stat fixture!\n");
+        exit(1);
+    }
+}
+
+
+/* ========================================================================
+ = BENCH_CGROUP_MEM
+ ======================================================================= */
+
+static void benchCgroupMem(void *arg) {
+    fixture_t *fixture = arg;
+
+    if (parseCgroupLimit(fixture->buf) < 0) {
+        fprintf(stderr, "Failed to parse memory.current fixture!\n");
+        exit(1);
+    }
+}
+
+
+/* ========================================================================
+ = BENCH_CGROUP_IO
+ ======================================================================= */
+
+static void benchCgroupIo(void *arg) {
+    fixture_t *fixture = arg;
+
+    parseCgroupIo(fixture->buf, fixture->len);
+}
+
+
+/* ========================================================================
+ = BENCH_CGROUP
+ =
+ = Cgroup v2 files of the fixture's own cgroup, if it captured one
+ ======================================================================= */
+
+static void benchCgroup(const char *root) {
+    char name[512];
+    fixture_t self, fixture;
+    size_t len;
+
+    if (loadFixture(root, "proc/self/cgroup", &self) < 0)
+        return;
+
+    if (strncmp(self.buf, "0::", 3)) {
+        free(self.buf);
+        return;
+    }
+
+    len = strcspn(self.buf + 3, "\n");
+    self.buf[3 + len] = '\0';
+
+    snprintf(name, sizeof(name), "sys/fs/cgroup%s/cpu.stat", self.buf + 3);
+    if (loadFixture(root, name, &fixture) == 0) {
+        benchRun(root, "cpu.stat", benchCgroupCpu, &fixture);
+        free(fixture.buf);
+    }
+
+    snprintf(name, sizeof(name), "sys/fs/cgroup%s/memory.current", self.buf + 3);
+    if (loadFixture(root, name, &fixture) == 0) {
+        benchRun(root, "memory.current", benchCgroupMem, &fixture);
+        free(fixture.buf);
+    }
+
+    snprintf(name, sizeof(name), "sys/fs/cgroup%s/io.stat", self.buf + 3);
+    if (loadFixture(root, name, &fixture) == 0) {
+        benchRun(root, "io.stat", benchCgroupIo, &fixture);
+        free(fixture.buf);
+    }
+
+    free(self.buf);
+}
+
+
+/* ========================================================================
+ = MAIN
+ =
+ = Usage: sysmon-bench <fixture root>...
+ ======================================================================= */
+
+int main(int argc, char *argv[]) {
+    static cpu_bench_t cpu;
+    disk_bench_t disk;
+    net_bench_t net;
+    proc_stat_t stat;
+    fixture_t fixture, previous;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <fixture root>...\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (loadFixture(argv[i], "proc/meminfo", &fixture) == 0) {
+            benchRun(argv[i], "meminfo", benchMeminfo, &fixture);
+            free(fixture.buf);
+        }
+
+        if (loadFixture(argv[i], "proc/stat", &fixture) == 0) {
+            benchRun(argv[i], "stat", benchStat, &fixture);
+            free(fixture.buf);
+        }
+
+        if (loadFixture(argv[i], "proc/diskstats", &fixture) == 0) {
+            disk.fixture = &fixture;
+            diskInit(&disk.disks, NULL);
+
+            disk.fullScan = 1;
+            benchRun(argv[i], "diskstats full", benchDiskstats, &disk);
+            disk.fullScan = 0;
+            benchRun(argv[i], "diskstats", benchDiskstats, &disk);
+            printf("%-24s %-16s %10d devices, %d monitored\n", argv[i], "",
+                (int)disk.disks.used, disk.disks.monitoredCount);
+
+            diskFree(&disk.disks);
+            free(fixture.buf);
+        }
+
+        if (loadFixture(argv[i], "proc/net/dev", &fixture) == 0) {
+            net.fixture = &fixture;
+            net.fullScan = 0;
+            netInit(&net.net, NULL);
+            benchRun(argv[i], "net/dev", benchNetdev, &net);
+            netFree(&net.net);
+            free(fixture.buf);
+        }
+
+        if (loadFixture(argv[i], "proc/loadavg", &fixture) == 0) {
+            benchRun(argv[i], "loadavg", benchLoadAvg, &fixture);
+            free(fixture.buf);
+        }
+
+        benchCgroup(argv[i]);
+    }
+
+    // a large core count is synthesized rather than captured; its 28 KB
+    // of text costs about as much to walk byte by byte as the parse takes
+    synthStat(SYNTH_CPUS, 1, &previous);
+    synthStat(SYNTH_CPUS, 2, &fixture);
+    parseStat(previous.buf, previous.len, &stat, &cpu.last);
+    parseStat(fixture.buf, fixture.len, &stat, &cpu.current);
+
+    benchRun("synthetic-512cpu", "stat", benchStat, &fixture);
+    benchRun("synthetic-512cpu", "cpu delta", benchCpuDelta, &cpu);
+    free(previous.buf);
+    free(fixture.buf);
+
+    synthNetdev(SYNTH_IFACES, &fixture);
+    net.fixture = &fixture;
+    netInit(&net.net, NULL);
+
+    net.fullScan = 1;
+    benchRun("synthetic-5kiface", "net/dev full", benchNetdev, &net);
+    net.fullScan = 0;
+    benchRun("synthetic-5kiface", "net/dev", benchNetdev, &net);
+    printf("%-24s %-16s %10d interfaces, %d monitored\n", "synthetic-5kiface", "",
+        net.net.lines, net.net.monitoredCount);
+
+    netFree(&net.net);
+    free(fixture.buf);
+
+    return 0;
+}
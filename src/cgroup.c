@@ -0,0 +1,316 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "sysmon.h"
+#include "proc.h"
+#include "cgroup.h"
+
+static const char *cgroupFiles[CGROUP_FILES] = {
+    [CGROUP_CPU_STAT]    = "cpu.stat",
+    [CGROUP_CPU_MAX]     = "cpu.max",
+    [CGROUP_CPUSET]      = "cpuset.cpus.effective",
+    [CGROUP_MEM_CURRENT] = "memory.current",
+    [CGROUP_MEM_MAX]     = "memory.max",
+    [CGROUP_IO_STAT]     = "io.stat"
+};
+
+
+/* ========================================================================
+ = PARSE_CGROUP_CPU
+ =
+ = Read usage, user and system time from cpu.stat, returns -1 when
+ = usage_usec is missing
+ ======================================================================= */
+
+int parseCgroupCpu(const char *buf, cgroup_cpu_t *cpu) {
+    static const struct {
+        const char *key;
+        size_t len;
+        size_t offset;
+    } fields[] = {
+        { "usage_usec ",  11, offsetof(cgroup_cpu_t, usage) },
+        { "user_usec ",   10, offsetof(cgroup_cpu_t, user) },
+        { "system_usec ", 12, offsetof(cgroup_cpu_t, system) }
+    };
+    int found = 0;
+
+    for (const char *p = buf; *p != '\0'; ) {
+        for (int i = 0; i < 3; i++) {
+            if (!strncmp(p, fields[i].key, fields[i].len)) {
+                *(unsigned long long *)((char *)cpu + fields[i].offset) = strtoull(p + fields[i].len, NULL, 10);
+                found |= 1 << i;
+                break;
+            }
+        }
+
+        if ((p = strchr(p, '\n')) == NULL)
+            break;
+        p++;
+    }
+
+    return (found & 1) ? 0 : -1;
+}
+
+
+/* ========================================================================
+ = PARSE_CGROUP_QUOTA
+ =
+ = CPUs worth of time allowed by a cpu.max "quota period" line, 0 when
+ = the quota is "max"
+ ======================================================================= */
+
+double parseCgroupQuota(const char *buf) {
+    double quota, period;
+    char *end;
+
+    quota = strtod(buf, &end);
+    if (end == buf)
+        return 0;
+
+    period = strtod(end, NULL);
+    return period > 0 ? quota / period : 0;
+}
+
+
+/* ========================================================================
+ = PARSE_CGROUP_CPUSET
+ =
+ = Count CPUs in a list like "0-3,8,10-11"
+ ======================================================================= */
+
+int parseCgroupCpuset(const char *buf) {
+    const char *p = buf;
+    int count = 0;
+
+    while (*p >= '0' && *p <= '9') {
+        char *end;
+        long first = strtol(p, &end, 10), last = first;
+
+        if (*end == '-')
+            last = strtol(end + 1, &end, 10);
+
+        count += MAX(0, last - first + 1);
+        if (*end != ',')
+            break;
+        p = end + 1;
+    }
+
+    return count;
+}
+
+
+/* ========================================================================
+ = PARSE_CGROUP_LIMIT
+ =
+ = Single value file such as memory.max, -1 for "max"
+ ======================================================================= */
+
+long long parseCgroupLimit(const char *buf) {
+    if (!strncmp(buf, "max", 3))
+        return -1;
+
+    return strtoll(buf, NULL, 10);
+}
+
+
+/* ========================================================================
+ = PARSE_CGROUP_IO
+ =
+ = Sum rbytes and wbytes over all devices in io.stat
+ ======================================================================= */
+
+unsigned long long parseCgroupIo(const char *buf, size_t len) {
+    const char *p = buf, *end = buf + len;
+    unsigned long long total = 0;
+
+    // "8:0 rbytes=1 wbytes=2 rios=3 wios=4 dbytes=5 dios=6", one per device
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+
+        if (eol == NULL)
+            eol = end;
+
+        for (const char *q = p; (q = memchr(q, 'b', eol - q)) != NULL; q++) {
+            if (q > p && (q[-1] == 'r' || q[-1] == 'w') && q + 6 < eol && !strncmp(q, "bytes=", 6))
+                total += strtoull(q + 6, NULL, 10);
+        }
+
+        p = eol + 1;
+    }
+
+    return total;
+}
+
+
+/* ========================================================================
+ = CGROUP_SELF_PATH
+ =
+ = Path of our own cgroup from the unified hierarchy line "0::/path"
+ ======================================================================= */
+
+static char *cgroupSelfPath(void) {
+    char line[4096], *path = NULL, *self = procPath(CGROUP_SELF);
+    FILE *file = fopen(self, "r");
+
+    free(self);
+    if (file == NULL)
+        return NULL;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (!strncmp(line, "0::", 3)) {
+            line[strcspn(line, "\n")] = '\0';
+            path = strdup(line + 3);
+            break;
+        }
+    }
+
+    fclose(file);
+    return path;
+}
+
+
+/* ========================================================================
+ = CGROUP_OPEN
+ =
+ = Open the interface files of a cgroup v2 directory, path is relative to
+ = the cgroup2 mount or "self". Files stay open and are re-read in place.
+ ======================================================================= */
+
+void cgroupOpen(cgroup_t *cgroup, const char *path) {
+    char *relative = NULL;
+
+    memset(cgroup, 0, sizeof(cgroup_t));
+
+    if (!strcmp(path, "self") && (path = relative = cgroupSelfPath()) == NULL) {
+        fprintf(stderr, "Cannot find own cgroup v2 in '%s'\n", CGROUP_SELF);
+        exit(1);
+    }
+
+    while (*path == '/') path++;
+    if ((cgroup->dir = malloc(strlen(CGROUP_ROOT) + strlen(path) + 2)) == NULL) {
+        fprintf(stderr, "Cannot allocate cgroup path\n");
+        exit(1);
+    }
+    sprintf(cgroup->dir, "%s/%s", CGROUP_ROOT, path);
+    free(relative);
+
+    for (int i = 0; i < CGROUP_FILES; i++) {
+        size_t len = strlen(cgroup->dir) + strlen(cgroupFiles[i]) + 2;
+
+        if ((cgroup->paths[i] = malloc(len)) == NULL) {
+            fprintf(stderr, "Cannot allocate cgroup path\n");
+            exit(1);
+        }
+        snprintf(cgroup->paths[i], len, "%s/%s", cgroup->dir, cgroupFiles[i]);
+
+        cgroup->available[i] = procTryOpen(&cgroup->files[i], cgroup->paths[i], O_RDONLY) == 0;
+    }
+
+    cgroup->onlineAvailable = procTryOpen(&cgroup->online, CPU_ONLINE, O_RDONLY) == 0;
+    cgroup->cpusAtOpen = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (!cgroup->available[CGROUP_CPU_STAT] || !cgroup->available[CGROUP_MEM_CURRENT]) {
+        fprintf(stderr, "'%s' is not a cgroup v2 directory with cpu and memory controllers\n",
+            cgroup->dir);
+        exit(1);
+    }
+}
+
+
+/* ========================================================================
+ = CGROUP_READ
+ =
+ = Re-read an optional file, returns NULL when it is not there
+ ======================================================================= */
+
+static const char *cgroupRead(cgroup_t *cgroup, int index) {
+    if (!cgroup->available[index])
+        return NULL;
+
+    return procTryRead(&cgroup->files[index]);
+}
+
+
+/* ========================================================================
+ = CGROUP_CPU
+ =
+ = CPU time used so far and how many CPUs the cgroup may use right now,
+ = the quota can be changed at any time so it is re-read as well
+ ======================================================================= */
+
+void cgroupCpu(cgroup_t *cgroup, cgroup_cpu_t *cpu) {
+    const char *buf;
+    double cpus = cgroup->cpusAtOpen;
+    int cpuset;
+
+    memset(cpu, 0, sizeof(cgroup_cpu_t));
+    if (parseCgroupCpu(procRead(&cgroup->files[CGROUP_CPU_STAT]), cpu) < 0) {
+        fprintf(stderr, "Failed to read required fields from '%s'!\n", cgroup->paths[CGROUP_CPU_STAT]);
+        exit(1);
+    }
+
+    // same list format as cpuset.cpus.effective
+    if (cgroup->onlineAvailable && (buf = procTryRead(&cgroup->online)) != NULL &&
+            (cpuset = parseCgroupCpuset(buf)) > 0)
+        cpus = cpuset;
+
+    if ((buf = cgroupRead(cgroup, CGROUP_CPUSET)) != NULL && (cpuset = parseCgroupCpuset(buf)) > 0)
+        cpus = MIN(cpus, cpuset);
+
+    if ((buf = cgroupRead(cgroup, CGROUP_CPU_MAX)) != NULL && parseCgroupQuota(buf) > 0)
+        cpus = MIN(cpus, parseCgroupQuota(buf));
+
+    cpu->cpus = MAX(cpus, 0.01);
+}
+
+
+/* ========================================================================
+ = CGROUP_MEM
+ =
+ = Memory charged to the cgroup and its limit
+ ======================================================================= */
+
+void cgroupMem(cgroup_t *cgroup, cgroup_mem_t *mem) {
+    const char *buf;
+
+    mem->current = parseCgroupLimit(procRead(&cgroup->files[CGROUP_MEM_CURRENT]));
+    mem->max = (buf = cgroupRead(cgroup, CGROUP_MEM_MAX)) != NULL ? parseCgroupLimit(buf) : -1;
+}
+
+
+/* ========================================================================
+ = CGROUP_IO_BYTES
+ =
+ = Bytes read and written by the cgroup, -1 without the io controller
+ ======================================================================= */
+
+long long cgroupIoBytes(cgroup_t *cgroup) {
+    proc_file_t *file = &cgroup->files[CGROUP_IO_STAT];
+
+    if (cgroupRead(cgroup, CGROUP_IO_STAT) == NULL)
+        return -1;
+
+    return (long long)parseCgroupIo(file->buf, file->len);
+}
@@ -0,0 +1,73 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CGROUP_H__
+#define __CGROUP_H__
+
+#include <stddef.h>
+
+#include "proc.h"
+
+#define CGROUP_ROOT "/sys/fs/cgroup"
+#define CGROUP_SELF "/proc/self/cgroup"
+#define CPU_ONLINE  "/sys/devices/system/cpu/online"
+
+enum {
+    CGROUP_CPU_STAT,    // required
+    CGROUP_CPU_MAX,     // missing on the root cgroup
+    CGROUP_CPUSET,
+    CGROUP_MEM_CURRENT, // required
+    CGROUP_MEM_MAX,     // missing on the root cgroup
+    CGROUP_IO_STAT,     // only with the io controller enabled
+    CGROUP_FILES
+};
+
+typedef struct {
+    char *dir;
+    char *paths[CGROUP_FILES];
+    proc_file_t files[CGROUP_FILES];
+    int available[CGROUP_FILES];
+    proc_file_t online;        // CPUs online, they can be hotplugged
+    int onlineAvailable;
+    int cpusAtOpen;            // when online cannot be read
+} cgroup_t;
+
+typedef struct {
+    unsigned long long usage;  // usec
+    unsigned long long user;
+    unsigned long long system;
+    double cpus;               // CPUs worth of time allowed by quota and cpuset
+} cgroup_cpu_t;
+
+typedef struct {
+    long long current;         // bytes
+    long long max;             // -1 when unlimited
+} cgroup_mem_t;
+
+int parseCgroupCpu(const char *buf, cgroup_cpu_t *cpu);
+double parseCgroupQuota(const char *buf);
+int parseCgroupCpuset(const char *buf);
+long long parseCgroupLimit(const char *buf);
+unsigned long long parseCgroupIo(const char *buf, size_t len);
+
+void cgroupOpen(cgroup_t *cgroup, const char *path);
+void cgroupCpu(cgroup_t *cgroup, cgroup_cpu_t *cpu);
+void cgroupMem(cgroup_t *cgroup, cgroup_mem_t *mem);
+long long cgroupIoBytes(cgroup_t *cgroup);
+
+#endif // __CGROUP_H__
@@ -0,0 +1,758 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/prctl.h>
+
+#include "sysmon.h"
+#include "proc.h"
+#include "meminfo.h"
+#include "cpu.h"
+#include "disk.h"
+#include "net.h"
+#include "cgroup.h"
+#include "shm.h"
+#include "psi.h"
+#include "sched.h"
+#include "ring.h"
+#include "stats.h"
+#include "collector.h"
+
+static const options_t *options;
+static sources_t sources;
+static disk_table_t disks;
+static net_table_t interfaces;
+static cgroup_t cgroup;
+static psi_t psi;
+static sched_t sched;
+static stat_t current, last;
+static ring_t *ring;
+static int wakeFd;
+static shm_t shm;
+static unsigned int configKey = 2166136261U; // FNV-1a of sample affecting options
+static int opened;
+static atomic_int idle; // set by the renderer, nothing on screen to sample for
+
+// meters back off up to SCHED_BACKOFF times their base interval while idle,
+// loadavg keeps a fixed rate so the graph's time axis stays even
+static sched_task_t tasks[TASK_COUNT] = {
+    [TASK_CPU]     = { "cpu",     TICK_MS, TICK_MS * SCHED_BACKOFF },
+    [TASK_MEM]     = { "mem",     TICK_MS, TICK_MS * SCHED_BACKOFF },
+    [TASK_IO]      = { "io",      TICK_MS, TICK_MS * SCHED_BACKOFF },
+    [TASK_LOADAVG] = { "loadavg", LOADAVG_INTERVAL * 1000, LOADAVG_INTERVAL * 1000 },
+    [TASK_PSI]     = { "psi",     PSI_INTERVAL, PSI_INTERVAL },
+    [TASK_NET]     = { "net",     TICK_MS, TICK_MS * SCHED_BACKOFF }
+};
+
+
+/* ========================================================================
+ = OPEN_SOURCES
+ =
+ = Open /proc files once, they are re-read in place on every sample
+ ======================================================================= */
+
+static void openSources(void) {
+    static const char *pressurePaths[PSI_COUNT] = {
+        PROC_PRESSURE_CPU, PROC_PRESSURE_MEMORY, PROC_PRESSURE_IO
+    };
+
+    procOpen(&sources.stat, PROC_STATS);
+    procOpen(&sources.meminfo, PROC_MEMINFO);
+    procOpen(&sources.diskstats, PROC_DISKSTATS);
+    procOpen(&sources.loadavg, PROC_LOADAVG);
+
+    diskInit(&disks, options->disks);
+    if (options->net) {
+        procOpen(&sources.netdev, PROC_NETDEV);
+        netInit(&interfaces, options->netFilter);
+    }
+
+    if (options->cgroup)
+        cgroupOpen(&cgroup, options->cgroup);
+    psiInit(&psi, pressurePaths);
+}
+
+
+/* ========================================================================
+ = METER_VALUE
+ =
+ = Pixel boundaries a meter of consecutive segments ends up drawing,
+ = packed into one value the scheduler can compare between samples
+ ======================================================================= */
+
+static long meterValue(const int *amounts, int count) {
+    long packed = 0;
+    int sum = 0;
+
+    for (int i = 0; i < count; i++) {
+        sum = CLAMP(sum + amounts[i], 0, 100);
+        packed = packed*(METER_WIDTH+1) + METER_PIXELS(sum);
+    }
+
+    return packed;
+}
+
+
+/* ========================================================================
+ = HEAT_LEVELS
+ =
+ = Shade levels of the busiest cores, idle cells stay at zero
+ ======================================================================= */
+
+static void heatLevels(const float *usage, int count, unsigned char *levels) {
+    int hottest[HEAT_CELLS];
+    int found = cpuHottest(usage, count, hottest, HEAT_CELLS);
+
+    for (int i = 0; i < HEAT_CELLS; i++) {
+        levels[i] = 0;
+
+        // any activity at all gets at least the first shade
+        if (i < found)
+            levels[i] = CLAMP((int)(usage[hottest[i]] * (HEAT_LEVELS-1) / 100.0F + 0.99F), 0, HEAT_LEVELS-1);
+    }
+}
+
+
+/* ========================================================================
+ = CGROUP_CPU_METER
+ =
+ = Replace host CPU percentages with time used by the cgroup relative to
+ = its quota, the cgroup has no iowait or steal of its own
+ ======================================================================= */
+
+static void cgroupCpuMeter(sample_t *sample, long int elapsed) {
+    static cgroup_cpu_t last;
+    cgroup_cpu_t cpu;
+    double allowed;
+
+    cgroupCpu(&cgroup, &cpu);
+
+    // usec of CPU time the quota allowed since the previous sample
+    allowed = MAX(1.0, elapsed * 1000.0 * cpu.cpus);
+
+    if (last.usage != 0) {
+        sample->cpu.total = (int)((cpu.usage - last.usage) * 100 / allowed);
+        sample->cpu.amounts[0] = (int)((cpu.user - last.user) * 100 / allowed);
+        sample->cpu.amounts[1] = (int)((cpu.system - last.system) * 100 / allowed);
+    } else {
+        sample->cpu.total = sample->cpu.amounts[0] = sample->cpu.amounts[1] = 0;
+    }
+    sample->cpu.amounts[2] = sample->cpu.amounts[3] = 0;
+
+    memcpy(&last, &cpu, sizeof(cgroup_cpu_t));
+}
+
+
+/* ========================================================================
+ = COLLECT_CPU
+ =
+ = Gather CPU stats, returns what the meter is going to show
+ ======================================================================= */
+
+static long collectCpu(sample_t *sample) {
+    static cpu_cores_t cores[2];
+    static float coreUsage[CPU_MAX_CORES];
+    static int flip;
+    cpu_stat_t *cur = &current.cpu, *prev = &last.cpu;
+    proc_file_t *file = &sources.stat;
+    proc_stat_t *f = &cur->fields, *l = &prev->fields;
+    long int dt, elapsed;
+
+    memcpy(prev, cur, sizeof(cpu_stat_t));
+
+    // per-core samples alternate between two buffers instead of copying
+    flip = !flip;
+    procRead(file);
+    if (parseStat(file->buf, file->len, f, &cores[flip]) < 0) {
+        fprintf(stderr, "Failed to read required fields from '%s'!\n", PROC_STATS);
+        exit(1);
+    }
+
+    // guest time is already part of user and nice
+    cur->stamp = sample->stamp;
+    cur->active = f->user + f->nice + f->sys + f->irq + f->softirq + f->steal;
+    cur->idle = f->idle + f->iowait;
+    cur->total = cur->active + cur->idle;
+
+    dt = MAX(1, cur->total - prev->total);
+    cur->user = (long int)((f->user + f->nice) - (l->user + l->nice))*100 / dt;
+    cur->sys = (long int)((f->sys + f->irq + f->softirq) - (l->sys + l->irq + l->softirq))*100 / dt;
+    cur->iowait = (long int)(f->iowait - l->iowait)*100 / dt;
+    cur->steal = (long int)(f->steal - l->steal)*100 / dt;
+
+    elapsed = MAX(1, cur->stamp - prev->stamp);
+    cur->ctxtRate = (long int)(f->ctxt - l->ctxt)*1000 / elapsed;
+    cur->forkRate = (long int)(f->processes - l->processes)*1000 / elapsed;
+
+    sample->cpu.total = MAX(0, cur->active - prev->active)*100 / dt;
+    sample->cpu.amounts[0] = cur->user;
+    sample->cpu.amounts[1] = cur->sys;
+    sample->cpu.amounts[2] = cur->iowait;
+    sample->cpu.amounts[3] = cur->steal;
+
+    // the heatmap keeps showing host cores, those are what we run on
+    cpuCoreUsage(&cores[flip], &cores[!flip], coreUsage);
+    heatLevels(coreUsage, cores[flip].count, sample->cpu.heat);
+
+    memcpy(&sample->cpu.fields, f, sizeof(proc_stat_t));
+    sample->cpu.ctxtRate = cur->ctxtRate;
+    sample->cpu.forkRate = cur->forkRate;
+
+    if (options->cgroup)
+        cgroupCpuMeter(sample, elapsed);
+
+    if (options->cpuMode == CPU_METER_STACKED)
+        return meterValue(sample->cpu.amounts, 4);
+
+    return meterValue(&sample->cpu.total, 1);
+}
+
+
+/* ========================================================================
+ = COLLECT_MEM
+ =
+ = Gather memory stats, returns what the meter is going to show
+ ======================================================================= */
+
+static long collectMem(sample_t *sample) {
+    proc_file_t *file = &sources.meminfo;
+    meminfo_t info;
+
+    procRead(file);
+    if (parseMeminfo(file->buf, file->len, &info) < 0 || info.total <= 0) {
+        fprintf(stderr, "Failed to read required fields from '%s'!\n", PROC_MEMINFO);
+        exit(1);
+    }
+
+    sample->mem.total = info.total * 1024LL;
+    sample->mem.used = memUsed(&info, options->memMode) * 1024LL;
+    sample->mem.swapTotal = info.swapTotal * 1024LL;
+    sample->mem.swapFree = info.swapFree * 1024LL;
+
+    // unlimited cgroups are bounded by the host
+    if (options->cgroup) {
+        cgroup_mem_t mem;
+
+        cgroupMem(&cgroup, &mem);
+        sample->mem.used = mem.current;
+        if (mem.max > 0)
+            sample->mem.total = mem.max;
+    }
+
+    sample->mem.available = MAX(0, sample->mem.total - sample->mem.used);
+    sample->mem.percent = sample->mem.used*100 / sample->mem.total;
+    return METER_PIXELS(sample->mem.percent);
+}
+
+
+/* ========================================================================
+ = COLLECT_IO
+ =
+ = Gather disk IO stats, returns what the meter is going to show
+ ======================================================================= */
+
+static long collectIo(sample_t *sample) {
+    io_stat_t *cur = &current.io, *prev = &last.io;
+    proc_file_t *file = &sources.diskstats;
+    long int delta;
+
+    memcpy(prev, cur, sizeof(io_stat_t));
+    memset(cur, 0, sizeof(io_stat_t));
+
+    // inside a cgroup the meter follows its own bytes instead of disk time
+    sample->io.bytes = options->cgroup && (cur->weighted = cgroupIoBytes(&cgroup)) >= 0;
+    if (!sample->io.bytes) {
+        procRead(file);
+        cur->weighted = diskWeighted(&disks, file->buf, file->len);
+    }
+    cur->stamp = sample->stamp;
+    sample->io.counter = cur->weighted;
+    sample->io.percent = -1;
+
+    // max was reset, wait until enough data has been cycled through
+    if (cur->max == -1 || prev->max == -1) return -1;
+
+    // scale to a base tick so backed off samples do not look busier
+    delta = (cur->weighted - prev->weighted) * TICK_MS / MAX(1, cur->stamp - prev->stamp);
+    cur->max = MAX(1, delta > prev->max ? delta : prev->max);
+
+    sample->io.percent = delta*100 / cur->max;
+    return METER_PIXELS(sample->io.percent);
+}
+
+
+/* ========================================================================
+ = COLLECT_NET
+ =
+ = Gather network throughput, returns what the meter is going to show
+ ======================================================================= */
+
+static long collectNet(sample_t *sample) {
+    net_stat_t *cur = &current.net, *prev = &last.net;
+    proc_file_t *file = &sources.netdev;
+    net_bytes_t bytes;
+    long int rx, tx, max, elapsed;
+
+    memcpy(prev, cur, sizeof(net_stat_t));
+
+    procRead(file);
+    netBytes(&interfaces, file->buf, file->len, &bytes);
+    cur->rx = bytes.rx;
+    cur->tx = bytes.tx;
+    cur->stamp = sample->stamp;
+    cur->generation = interfaces.generation;
+    sample->net.rx = cur->rx;
+    sample->net.tx = cur->tx;
+    sample->net.amounts[0] = sample->net.amounts[1] = -1;
+
+    // first sample, interfaces came or went and the sums jumped with them,
+    // or a driver reset its counters
+    if (prev->max == -1 || cur->generation != prev->generation
+            || cur->rx < prev->rx || cur->tx < prev->tx) {
+        cur->max = MAX(0, prev->max);
+        return -1;
+    }
+
+    // per base tick like the IO meter, so backoff does not inflate it
+    elapsed = MAX(1, cur->stamp - prev->stamp);
+    rx = (long int)((cur->rx - prev->rx) * TICK_MS / elapsed);
+    tx = (long int)((cur->tx - prev->tx) * TICK_MS / elapsed);
+
+    // let an old peak fade so one burst does not flatten the meter for good
+    max = prev->max - (long int)((long long)prev->max * MIN(elapsed, TICK_MS * NET_MAX_DECAY)
+        / (TICK_MS * NET_MAX_DECAY));
+    cur->max = MAX(1, MAX(rx + tx, max));
+
+    sample->net.amounts[0] = rx*100 / cur->max;
+    sample->net.amounts[1] = tx*100 / cur->max;
+    return meterValue(sample->net.amounts, 2);
+}
+
+
+/* ========================================================================
+ = COLLECT_LOADAVG
+ =
+ = Read the 1, 5 and 15 minute load averages
+ ======================================================================= */
+
+static long collectLoadAvg(sample_t *sample) {
+    const char *buf = procRead(&sources.loadavg);
+
+    if (parseLoadAvg(buf, sample->loadavg) < 0) {
+        fprintf(stderr, "Failed to read required fields from '%s'!\n", PROC_LOADAVG);
+        exit(1);
+    }
+
+    return 0;
+}
+
+
+/* ========================================================================
+ = COLLECT_PRESSURE
+ =
+ = Snapshot until when each resource is considered stalled
+ ======================================================================= */
+
+static long collectPressure(sample_t *sample) {
+    for (int i = 0; i < PSI_COUNT; i++) {
+        sample->pressure.stallEnd[i] = psiStallEnd(&psi, i);
+        sample->pressure.avg10[i] = psi.source[i].available ? psi.source[i].avg10 : -1.0F;
+    }
+
+    return 0;
+}
+
+
+/* ========================================================================
+ = REPORT_TICK
+ =
+ = Print collected stats and /proc syscalls issued since the previous tick
+ ======================================================================= */
+
+static void reportTick(void) {
+    static proc_syscalls_t prev;
+    cpu_stat_t *cpu = &current.cpu;
+
+    fprintf(stderr, "tick: cpu %d%% usr %d%% sys %d%% io %d%% steal, "
+        "%ld ctxt/s, %ld forks/s, %ld running, %ld blocked; "
+        "psi %.2f cpu %.2f mem %.2f io; "
+        "%lu reads, %lu opens, %lu closes\n",
+        cpu->user, cpu->sys, cpu->iowait, cpu->steal,
+        cpu->ctxtRate, cpu->forkRate, cpu->fields.running, cpu->fields.blocked,
+        psi.source[PSI_CPU].avg10, psi.source[PSI_MEM].avg10, psi.source[PSI_IO].avg10,
+        procSyscalls.reads - prev.reads,
+        procSyscalls.opens - prev.opens,
+        procSyscalls.closes - prev.closes);
+
+    memcpy(&prev, &procSyscalls, sizeof(proc_syscalls_t));
+}
+
+
+/* ========================================================================
+ = REPORT_SCHED
+ =
+ = Print wakeup rate and the interval each task has settled on
+ ======================================================================= */
+
+static void reportSched(void) {
+    fprintf(stderr, "sched: %lu wakeups/min;", sched.wakeupsPerMin);
+
+    for (int i = 0; i < sched.count; i++)
+        fprintf(stderr, " %s %lld ms (%lu runs)", sched.tasks[i].name,
+            sched.tasks[i].intervalMs, sched.tasks[i].runs);
+
+    fprintf(stderr, "\n");
+}
+
+
+/* ========================================================================
+ = PUBLISH
+ =
+ = Hand a sample to the renderer, and to other instances if we publish
+ ======================================================================= */
+
+static void publish(sample_t *sample, int task) {
+    sample->task = task;
+    ringPush(ring, sample);
+
+    if (shm.role == SHM_PUBLISHER)
+        shmStore(&shm, sample);
+}
+
+
+/* ========================================================================
+ = WAKE_RENDERER
+ =
+ = Signal the renderer that the ring has new samples
+ ======================================================================= */
+
+static void wakeRenderer(void) {
+    uint64_t one = 1;
+
+    // EAGAIN only means the renderer has plenty to wake up for already
+    if (write(wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        fprintf(stderr, "Cannot wake renderer: %s\n", strerror(errno));
+        exit(1);
+    }
+}
+
+
+/* ========================================================================
+ = HASH_OPTION
+ =
+ = Fold an option into the key that selects the shared segment
+ ======================================================================= */
+
+static void hashOption(const char *value) {
+    for (const char *p = value ? value : ""; ; p++) {
+        configKey = (configKey ^ (unsigned char)*p) * 16777619U;
+        if (*p == '\0') break;
+    }
+}
+
+
+/* ========================================================================
+ = ATTACH
+ =
+ = Pick how samples are obtained: from a shared publisher, by publishing
+ = them ourselves, or on our own when sharing is off or unavailable
+ ======================================================================= */
+
+static void attach(void) {
+    char flags[32];
+
+    // a cgroup scope is private to the instance, self even resolves per process
+    if (options->shared && !options->cgroup) {
+        unsigned int key = configKey;
+
+        snprintf(flags, sizeof(flags), "%d %d %d %d", options->memMode, options->cpuMode,
+            options->net, (int)sizeof(sample_t));
+        hashOption(flags);
+        hashOption(options->disks);
+        hashOption(options->netFilter);
+
+        shmAttach(&shm, configKey, nowMs());
+        configKey = key;
+
+        if (options->verbose)
+            fprintf(stderr, "shared: %s %s (publisher %d)\n",
+                shm.role == SHM_FOLLOWER ? "following" :
+                shm.role == SHM_PUBLISHER ? "publishing" : "unavailable, sampling locally",
+                shm.name, (int)shmPublisher(&shm));
+    }
+
+    if (shm.role != SHM_FOLLOWER && !opened) {
+        openSources();
+        opened = 1;
+
+        // all deadlines are relative to when sampling actually begins
+        schedInit(&sched, tasks, TASK_COUNT, nowMs());
+    }
+}
+
+
+/* ========================================================================
+ = FOLLOW
+ =
+ = Pass samples of the shared publisher on to the renderer until it goes
+ = away
+ ======================================================================= */
+
+static void follow(void) {
+    sample_t samples[TASK_COUNT];
+    int count;
+
+    while ((count = shmFetch(&shm, samples, nowMs())) >= 0) {
+        for (int i = 0; i < count; i++)
+            ringPush(ring, &samples[i]);
+
+        if (count > 0)
+            wakeRenderer();
+
+        shmWait(&shm, SHM_CHECK_MS);
+        schedWakeup(&sched, nowMs());
+    }
+
+    shmDetach(&shm);
+}
+
+
+/* ========================================================================
+ = COLLECTOR_EXIT
+ =
+ = Withdraw the shared segment when the process exits
+ ======================================================================= */
+
+static void collectorExit(void) {
+    shmDetach(&shm);
+}
+
+
+/* ========================================================================
+ = RUN_TASK
+ =
+ = Sample one metric and publish it, returns the value its backoff is
+ = based on
+ ======================================================================= */
+
+static long runTask(int task) {
+    sample_t sample;
+    long value = 0;
+    long long start = nowNs();
+
+    memset(&sample, 0, sizeof(sample_t));
+    sample.stamp = nowMs();
+
+    switch (task) {
+        case TASK_CPU:
+            value = collectCpu(&sample);
+            if (options->verbose)
+                reportTick();
+            break;
+        case TASK_MEM:
+            value = collectMem(&sample);
+            break;
+        case TASK_IO:
+#ifdef SIZE_SMALL
+            return 0;
+#else
+            if (options->net)
+                return 0;
+            value = collectIo(&sample);
+            break;
+#endif
+        case TASK_LOADAVG:
+            value = collectLoadAvg(&sample);
+            break;
+        case TASK_PSI:
+            psiUpdate(&psi, sample.stamp);
+            value = collectPressure(&sample);
+            break;
+        case TASK_NET:
+#ifdef SIZE_SMALL
+            return 0;
+#else
+            if (!options->net)
+                return 0;
+            value = collectNet(&sample);
+            break;
+#endif
+    }
+
+    statsCollect(task, nowNs() - start);
+    publish(&sample, task);
+    return value;
+}
+
+
+/* ========================================================================
+ = COLLECTOR_MAIN
+ =
+ = Collector thread, sleeps until the next deadline or pressure event and
+ = never touches the X connection
+ ======================================================================= */
+
+static void *collectorMain(void *arg) {
+    struct pollfd fds[PSI_COUNT];
+    int fdSources[PSI_COUNT], due[TASK_COUNT];
+    long long retry = nowMs() + SHM_RETRY_MS;
+
+    // let the kernel merge our wakeup with others, the scheduler already
+    // batches every deadline that falls within the same window
+    prctl(PR_SET_TIMERSLACK, SCHED_SLACK_MS * 1000000UL);
+
+    while (1) {
+        int nfds, count, published = 0;
+        long long wake, tickStart, next = schedNext(&sched);
+
+        if (shm.role == SHM_FOLLOWER) {
+            follow();
+            attach();
+            retry = nowMs() + SHM_RETRY_MS;
+            continue;
+        }
+
+        // sampling on our own, see now and then whether sharing came back
+        if (options->shared && shm.role == SHM_LOCAL) {
+            if (nowMs() >= retry) {
+                attach();
+                retry = nowMs() + SHM_RETRY_MS;
+                continue;
+            }
+            next = MIN(next, retry);
+        }
+
+        nfds = psiPollFds(&psi, fds, fdSources, PSI_COUNT);
+        if (poll(fds, nfds, (int)MAX(0, next - nowMs())) < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "poll failed: %s\n", strerror(errno));
+            exit(1);
+        }
+
+        tickStart = nowNs();
+        statsWakeup();
+
+        wake = nowMs();
+        if (schedWakeup(&sched, wake) && options->verbose)
+            reportSched();
+
+        for (int i = 0; i < nfds; i++) {
+            if (fds[i].revents) {
+                psiEvent(&psi, fdSources[i], fds[i].revents, nowMs());
+                published = 1;
+            }
+        }
+
+        // a fresh stall shows up right away rather than on the next psi run
+        if (published) {
+            sample_t sample;
+
+            memset(&sample, 0, sizeof(sample_t));
+            sample.stamp = wake;
+            collectPressure(&sample);
+            publish(&sample, TASK_PSI);
+        }
+
+        schedIdle(&sched, atomic_load_explicit(&idle, memory_order_relaxed), nowMs());
+        count = schedDue(&sched, nowMs(), due);
+        for (int i = 0; i < count; i++)
+            schedDone(&sched, due[i], runTask(due[i]), nowMs());
+
+        if (published || count > 0) {
+            shmCommit(&shm, nowMs());
+            wakeRenderer();
+            statsTick(nowNs() - tickStart,
+                procSyscalls.opens + procSyscalls.reads + procSyscalls.closes);
+        }
+    }
+
+    return arg;
+}
+
+
+/* ========================================================================
+ = COLLECTOR_INIT
+ =
+ = Set up the task schedule, options are read once collection starts
+ ======================================================================= */
+
+void collectorInit(const options_t *opts) {
+    options = opts;
+    schedInit(&sched, tasks, TASK_COUNT, nowMs());
+}
+
+
+/* ========================================================================
+ = COLLECTOR_CONFIGURE
+ =
+ = Apply an --interval spec, returns -1 if it is invalid
+ ======================================================================= */
+
+int collectorConfigure(const char *spec) {
+    hashOption(spec);
+    return schedConfigure(&sched, spec);
+}
+
+
+/* ========================================================================
+ = COLLECTOR_START
+ =
+ = Start collecting in a thread of its own, samples go to the ring and
+ = every batch is signalled on wakeFd
+ ======================================================================= */
+
+void collectorStart(ring_t *samples, int fd) {
+    pthread_t thread;
+    int err;
+
+    ring = samples;
+    wakeFd = fd;
+    current.io.max = -1; // signal that max has been reset
+    current.net.max = -1;
+
+    attach();
+    atexit(collectorExit);
+
+    if ((err = pthread_create(&thread, NULL, collectorMain, NULL)) != 0) {
+        fprintf(stderr, "Cannot start collector thread: %s\n", strerror(err));
+        exit(1);
+    }
+
+    pthread_detach(thread);
+}
+
+
+/* ========================================================================
+ = COLLECTOR_IDLE
+ =
+ = Called by the renderer when its display can or cannot be seen. Meters
+ = slow down to their backoff ceiling while idle, loadavg keeps its rate so
+ = the history has no gaps. Samples others depend on are never slowed.
+ ======================================================================= */
+
+void collectorIdle(int hidden) {
+    atomic_store_explicit(&idle, hidden && !options->shared && !options->metrics, memory_order_relaxed);
+}
@@ -0,0 +1,249 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include <X11/Xlib.h>
+
+#include "sysmon.h"
+#include "stats.h"
+#include "fb.h"
+#include "delta.h"
+#include "comp.h"
+
+
+/* ========================================================================
+ = COMP_INIT
+ =
+ = Start with nothing known on screen and both windows unmapped. The
+ = window manager decides which of them is shown, MapNotify tells us
+ = without a round trip per window.
+ ======================================================================= */
+
+void compInit(comp_t *comp, Display *display, Drawable source, GC gc, fb_t *fb, delta_t *delta,
+    const Window *windows) {
+    memset(comp, 0, sizeof(comp_t));
+    comp->display = display;
+    comp->source = source;
+    comp->gc = gc;
+    comp->fb = fb;
+    comp->delta = delta;
+
+    for (int i = 0; i < COMP_WINDOWS; i++)
+        comp->windows[i] = windows[i];
+}
+
+
+/* ========================================================================
+ = COMP_SHOWS
+ =
+ = Whether the widget at x,y is known to show state, records nothing
+ ======================================================================= */
+
+int compShows(const comp_t *comp, int x, int y, const void *state, size_t len) {
+    for (int i = 0; i < comp->widgetCount; i++) {
+        const comp_widget_t *widget = &comp->widgets[i];
+
+        if (widget->x == x && widget->y == y)
+            return widget->len == len && !memcmp(widget->state, state, len);
+    }
+
+    return 0;
+}
+
+
+/* ========================================================================
+ = COMP_UNCHANGED
+ =
+ = Returns 1 if the widget at x,y already shows state, otherwise records
+ = state as what it is about to show and returns 0
+ ======================================================================= */
+
+int compUnchanged(comp_t *comp, int x, int y, const void *state, size_t len) {
+    comp_widget_t *widget = NULL;
+
+    for (int i = 0; i < comp->widgetCount; i++) {
+        if (comp->widgets[i].x == x && comp->widgets[i].y == y) {
+            widget = &comp->widgets[i];
+            break;
+        }
+    }
+
+    if (widget != NULL && widget->len == len && !memcmp(widget->state, state, len)) {
+        comp->skipped++;
+        return 1;
+    }
+
+    // too large or too many to track, always drawn
+    if (len > COMP_STATE_SIZE || (widget == NULL && comp->widgetCount == COMP_WIDGETS))
+        return 0;
+
+    if (widget == NULL) {
+        widget = &comp->widgets[comp->widgetCount++];
+        widget->x = x;
+        widget->y = y;
+    }
+
+    widget->len = len;
+    memcpy(widget->state, state, len);
+    return 0;
+}
+
+
+/* ========================================================================
+ = COMP_INVALIDATE
+ =
+ = Forget what widgets show, after the background was repainted
+ ======================================================================= */
+
+void compInvalidate(comp_t *comp) {
+    comp->widgetCount = 0;
+}
+
+
+/* ========================================================================
+ = COMP_DAMAGE
+ =
+ = Add a changed area, merging it with any rectangle it touches
+ ======================================================================= */
+
+void compDamage(comp_t *comp, int x, int y, int width, int height) {
+    comp_rect_t rect = { x, y, x + width, y + height };
+    int merged;
+
+    // a merge can make the result touch others, repeat until it stands alone
+    do {
+        merged = 0;
+        for (int i = 0; i < comp->rectCount; i++) {
+            comp_rect_t *other = &comp->rects[i];
+
+            if (rect.x1 > other->x2 || other->x1 > rect.x2 || rect.y1 > other->y2 || other->y1 > rect.y2)
+                continue;
+
+            rect.x1 = MIN(rect.x1, other->x1);
+            rect.y1 = MIN(rect.y1, other->y1);
+            rect.x2 = MAX(rect.x2, other->x2);
+            rect.y2 = MAX(rect.y2, other->y2);
+            comp->rects[i] = comp->rects[--comp->rectCount];
+            merged = 1;
+            break;
+        }
+    } while (merged);
+
+    // out of slots, everything becomes one bounding box
+    if (comp->rectCount == COMP_RECTS) {
+        for (int i = 0; i < comp->rectCount; i++) {
+            rect.x1 = MIN(rect.x1, comp->rects[i].x1);
+            rect.y1 = MIN(rect.y1, comp->rects[i].y1);
+            rect.x2 = MAX(rect.x2, comp->rects[i].x2);
+            rect.y2 = MAX(rect.y2, comp->rects[i].y2);
+        }
+        comp->rectCount = 0;
+    }
+
+    comp->rects[comp->rectCount++] = rect;
+}
+
+
+/* ========================================================================
+ = COMP_EVENT
+ =
+ = Follow which windows are on screen, whether anything covers them and
+ = what the server lost
+ ======================================================================= */
+
+void compEvent(comp_t *comp, const XEvent *event) {
+    if (comp->delta != NULL && event->type == Expose)
+        deltaExpose(comp->delta, event->xexpose.x, event->xexpose.y,
+            event->xexpose.width, event->xexpose.height);
+
+    for (int i = 0; i < COMP_WINDOWS; i++) {
+        if (event->type == MapNotify && event->xmap.window == comp->windows[i])
+            comp->mapped[i] = 1;
+        if (event->type == UnmapNotify && event->xunmap.window == comp->windows[i])
+            comp->mapped[i] = 0;
+        if (event->type == VisibilityNotify && event->xvisibility.window == comp->windows[i])
+            comp->obscured[i] = event->xvisibility.state == VisibilityFullyObscured;
+    }
+
+    if (comp->fb != NULL)
+        fbEvent(comp->fb, event);
+}
+
+
+/* ========================================================================
+ = COMP_FLUSH
+ =
+ = Push every dirty rectangle of the frame to the mapped windows in one
+ = go, returns the number of requests queued
+ ======================================================================= */
+
+int compFlush(comp_t *comp) {
+    Window targets[COMP_WINDOWS];
+    int count = 0, requests = 0;
+
+    if (comp->rectCount == 0)
+        return 0;
+
+    for (int i = 0; i < COMP_WINDOWS; i++)
+        if (comp->mapped[i])
+            targets[count++] = comp->windows[i];
+
+    if (comp->fb != NULL) {
+        for (int i = 0; i < comp->rectCount; i++)
+            fbDamage(comp->fb, comp->rects[i].x1, comp->rects[i].y1,
+                comp->rects[i].x2 - comp->rects[i].x1, comp->rects[i].y2 - comp->rects[i].y1);
+
+        // an upload still in flight leaves the damage with the framebuffer
+        requests = fbFlush(comp->fb, targets, count);
+    }
+    else {
+        for (int i = 0; i < comp->rectCount; i++) {
+            int x = comp->rects[i].x1, y = comp->rects[i].y1;
+            int width = comp->rects[i].x2 - x, height = comp->rects[i].y2 - y;
+
+            // only the box around the pixels that really differ, if any
+            if (comp->delta != NULL && !deltaChanged(comp->delta, &x, &y, &width, &height))
+                continue;
+
+            for (int j = 0; j < count; j++)
+                XCopyArea(comp->display, comp->source, targets[j], comp->gc,
+                    x, y, width, height, x, y);
+            requests += count;
+        }
+        stats.xBytes += (unsigned long long)requests * X_COPY_AREA_BYTES;
+    }
+
+    comp->rectCount = 0;
+    return requests;
+}
+
+
+/* ========================================================================
+ = COMP_VISIBLE
+ =
+ = Whether any window is mapped and not completely covered
+ ======================================================================= */
+
+int compVisible(const comp_t *comp) {
+    for (int i = 0; i < COMP_WINDOWS; i++)
+        if (comp->mapped[i] && !comp->obscured[i])
+            return 1;
+
+    return 0;
+}
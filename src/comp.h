@@ -0,0 +1,69 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __COMP_H__
+#define __COMP_H__
+
+#include <stddef.h>
+#include <X11/Xlib.h>
+
+#include "fb.h"
+#include "delta.h"
+
+#define COMP_WINDOWS    2   // the dockapp window and its icon window
+#define COMP_WIDGETS    16
+#define COMP_STATE_SIZE 128 // bytes describing what a widget shows
+#define COMP_RECTS      8   // more dirty rectangles collapse into one
+
+typedef struct {
+    int x, y;               // where the widget is drawn, identifies it
+    size_t len;
+    unsigned char state[COMP_STATE_SIZE];
+} comp_widget_t;
+
+typedef struct {
+    int x1, y1, x2, y2;
+} comp_rect_t;
+
+typedef struct {
+    Display *display;
+    Drawable source;        // master pixmap, unused with a framebuffer
+    GC gc;
+    fb_t *fb;               // NULL when drawing with X copies
+    delta_t *delta;         // copies only changed pixels, NULL to copy whole rects
+    Window windows[COMP_WINDOWS];
+    int mapped[COMP_WINDOWS];
+    int obscured[COMP_WINDOWS]; // fully covered, VisibilityNotify
+    comp_widget_t widgets[COMP_WIDGETS];
+    int widgetCount;
+    comp_rect_t rects[COMP_RECTS];
+    int rectCount;
+    unsigned long skipped;  // draws saved by unchanged widgets
+} comp_t;
+
+void compInit(comp_t *comp, Display *display, Drawable source, GC gc, fb_t *fb, delta_t *delta,
+    const Window *windows);
+int compShows(const comp_t *comp, int x, int y, const void *state, size_t len);
+int compUnchanged(comp_t *comp, int x, int y, const void *state, size_t len);
+void compInvalidate(comp_t *comp);
+void compDamage(comp_t *comp, int x, int y, int width, int height);
+void compEvent(comp_t *comp, const XEvent *event);
+int compFlush(comp_t *comp);
+int compVisible(const comp_t *comp);
+
+#endif // __COMP_H__
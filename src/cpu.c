@@ -0,0 +1,229 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "sysmon.h"
+#include "cpu.h"
+
+
+/* ========================================================================
+ = NEXT_U32
+ =
+ = Skip spaces and parse a decimal field, truncated to 32 bits
+ ======================================================================= */
+
+static inline const char *nextU32(const char *p, uint32_t *value) {
+    uint32_t v = 0;
+
+    while (*p == ' ') p++;
+    for (; *p >= '0' && *p <= '9'; p++)
+        v = v*10 + (*p - '0');
+
+    *value = v;
+    return p;
+}
+
+
+/* ========================================================================
+ = NEXT_U64
+ ======================================================================= */
+
+static inline const char *nextU64(const char *p, unsigned long long *value) {
+    unsigned long long v = 0;
+
+    while (*p == ' ') p++;
+    for (; *p >= '0' && *p <= '9'; p++)
+        v = v*10 + (*p - '0');
+
+    *value = v;
+    return p;
+}
+
+
+/* ========================================================================
+ = PARSE_STAT
+ =
+ = Decode /proc/stat in one pass: the aggregate cpu line, every cpuN line
+ = and the scheduler counters after them. Returns -1 if malformed.
+ ======================================================================= */
+
+int parseStat(const char *buf, size_t len, proc_stat_t *stat, cpu_cores_t *cores) {
+    const char *p = buf, *end = buf + len;
+    unsigned long long value;
+    int found = 0;
+
+    memset(stat, 0, sizeof(proc_stat_t));
+
+    if (len < 4 || memcmp(p, "cpu ", 4))
+        return -1;
+
+    p = nextU64(p + 4, &stat->user);
+    p = nextU64(p, &stat->nice);
+    p = nextU64(p, &stat->sys);
+    p = nextU64(p, &stat->idle);
+    p = nextU64(p, &stat->iowait);
+    p = nextU64(p, &stat->irq);
+    p = nextU64(p, &stat->softirq);
+    p = nextU64(p, &stat->steal);
+    p = nextU64(p, &stat->guest);
+    p = nextU64(p, &stat->guestNice);
+
+    if ((p = memchr(p, '\n', end - p)) == NULL)
+        return -1;
+    p = parseCpuCores(p + 1, end, cores);
+
+    // intr can be tens of kilobytes, only the line start is ever looked at
+    while (p < end && found < 4) {
+        const char *eol;
+
+        if (!strncmp(p, "ctxt ", 5)) {
+            nextU64(p + 5, &stat->ctxt);
+            found++;
+        }
+        else if (!strncmp(p, "processes ", 10)) {
+            nextU64(p + 10, &stat->processes);
+            found++;
+        }
+        else if (!strncmp(p, "procs_running ", 14)) {
+            nextU64(p + 14, &value);
+            stat->running = value;
+            found++;
+        }
+        else if (!strncmp(p, "procs_blocked ", 14)) {
+            nextU64(p + 14, &value);
+            stat->blocked = value;
+            found++;
+        }
+
+        if ((eol = memchr(p, '\n', end - p)) == NULL)
+            break;
+        p = eol + 1;
+    }
+
+    return 0;
+}
+
+
+/* ========================================================================
+ = PARSE_CPU_CORES
+ =
+ = Parse cpuN lines starting at p, returns start of the first line after
+ ======================================================================= */
+
+const char *parseCpuCores(const char *p, const char *end, cpu_cores_t *cores) {
+    int next = 0, padded;
+
+    while (end - p > 3 && p[0] == 'c' && p[1] == 'p' && p[2] == 'u') {
+        uint32_t id, unused;
+
+        p = nextU32(p + 3, &id);
+        if (id >= CPU_MAX_CORES)
+            break;
+
+        // offline cores leave gaps in the numbering
+        for (; next < (int)id; next++) {
+            cores->user[next] = cores->nice[next] = cores->sys[next] = 0;
+            cores->idle[next] = cores->iowait[next] = cores->steal[next] = 0;
+        }
+
+        p = nextU32(p, &cores->user[id]);
+        p = nextU32(p, &cores->nice[id]);
+        p = nextU32(p, &cores->sys[id]);
+        p = nextU32(p, &cores->idle[id]);
+        p = nextU32(p, &cores->iowait[id]);
+        p = nextU32(p, &unused); // irq
+        cores->sys[id] += unused;
+        p = nextU32(p, &unused); // softirq
+        cores->sys[id] += unused;
+        p = nextU32(p, &cores->steal[id]);
+        next = id + 1;
+
+        if ((p = memchr(p, '\n', end - p)) == NULL) {
+            p = end;
+            break;
+        }
+        p++;
+    }
+
+    // zero the tail of the last block so the kernel can run whole blocks
+    padded = MIN(CPU_MAX_CORES, (next + CPU_LANES - 1) / CPU_LANES * CPU_LANES);
+    for (int i = next; i < padded; i++) {
+        cores->user[i] = cores->nice[i] = cores->sys[i] = 0;
+        cores->idle[i] = cores->iowait[i] = cores->steal[i] = 0;
+    }
+
+    cores->count = next;
+    return p;
+}
+
+
+/* ========================================================================
+ = CPU_CORE_USAGE
+ =
+ = Per-core busy percentage between two samples. Works on fixed blocks of
+ = CPU_LANES cores with no branches so the compiler can vectorize it.
+ ======================================================================= */
+
+void cpuCoreUsage(const cpu_cores_t *current, const cpu_cores_t *last, float *usage) {
+    int count = MIN(current->count, last->count);
+
+    for (int base = 0; base < count; base += CPU_LANES) {
+        const uint32_t *restrict cu = current->user + base, *restrict lu = last->user + base;
+        const uint32_t *restrict cn = current->nice + base, *restrict ln = last->nice + base;
+        const uint32_t *restrict cs = current->sys + base, *restrict ls = last->sys + base;
+        const uint32_t *restrict ci = current->idle + base, *restrict li = last->idle + base;
+        const uint32_t *restrict cw = current->iowait + base, *restrict lw = last->iowait + base;
+        const uint32_t *restrict ct = current->steal + base, *restrict lt = last->steal + base;
+        float *restrict out = usage + base;
+
+        for (int i = 0; i < CPU_LANES; i++) {
+            int32_t busy = (int32_t)((cu[i] - lu[i]) + (cn[i] - ln[i]) + (cs[i] - ls[i]) + (ct[i] - lt[i]));
+            int32_t idle = (int32_t)((ci[i] - li[i]) + (cw[i] - lw[i]));
+            int32_t total = busy + idle;
+
+            total += (total == 0); // avoid dividing by zero without a branch
+            out[i] = (float)busy * 100.0F / (float)total;
+        }
+    }
+}
+
+
+/* ========================================================================
+ = CPU_HOTTEST
+ =
+ = Indices of up to max busiest cores, sorted descending
+ ======================================================================= */
+
+int cpuHottest(const float *usage, int count, int *hottest, int max) {
+    int found = 0;
+
+    for (int i = 0; i < count; i++) {
+        int j;
+
+        if (found == max && usage[i] <= usage[hottest[found-1]])
+            continue;
+
+        j = (found < max) ? found++ : found - 1;
+        for (; j > 0 && usage[hottest[j-1]] < usage[i]; j--)
+            hottest[j] = hottest[j-1];
+        hottest[j] = i;
+    }
+
+    return found;
+}
@@ -0,0 +1,66 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __CPU_H__
+#define __CPU_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CPU_MAX_CORES 1024
+#define CPU_LANES     8 // cores per block in the delta kernel
+
+// every column of the aggregate cpu line plus the scheduler counters
+typedef struct {
+    unsigned long long user;
+    unsigned long long nice;
+    unsigned long long sys;
+    unsigned long long idle;
+    unsigned long long iowait;
+    unsigned long long irq;
+    unsigned long long softirq;
+    unsigned long long steal;
+    unsigned long long guest;     // already included in user
+    unsigned long long guestNice; // already included in nice
+    unsigned long long ctxt;
+    unsigned long long processes;
+    long int running;
+    long int blocked;
+} proc_stat_t;
+
+/*
+ * Per-core jiffies as structure-of-arrays. Counters are kept as 32 bits,
+ * unsigned subtraction gives the right delta across wraparound as long as
+ * less than 2^32 jiffies pass between two samples.
+ */
+typedef struct {
+    int count;
+    uint32_t user[CPU_MAX_CORES];
+    uint32_t nice[CPU_MAX_CORES];
+    uint32_t sys[CPU_MAX_CORES];
+    uint32_t idle[CPU_MAX_CORES];
+    uint32_t iowait[CPU_MAX_CORES];
+    uint32_t steal[CPU_MAX_CORES];
+} cpu_cores_t;
+
+int parseStat(const char *buf, size_t len, proc_stat_t *stat, cpu_cores_t *cores);
+const char *parseCpuCores(const char *p, const char *end, cpu_cores_t *cores);
+void cpuCoreUsage(const cpu_cores_t *current, const cpu_cores_t *last, float *usage);
+int cpuHottest(const float *usage, int count, int *hottest, int max);
+
+#endif // __CPU_H__
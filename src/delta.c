@@ -0,0 +1,109 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include "sysmon.h"
+#include "delta.h"
+
+
+/* ========================================================================
+ = DELTA_INIT
+ =
+ = Nothing has been sent yet, the first flush copies every pixel.
+ = Returns -1 if out of memory.
+ ======================================================================= */
+
+int deltaInit(delta_t *delta, XImage *shadow, int width, int height) {
+    memset(delta, 0, sizeof(delta_t));
+    delta->shadow = shadow;
+    delta->width = MIN(width, shadow->width);
+    delta->height = MIN(height, shadow->height);
+
+    delta->sent = calloc(delta->width * delta->height, sizeof(unsigned long));
+    delta->valid = calloc(delta->width * delta->height, 1);
+    if (delta->sent == NULL || delta->valid == NULL) {
+        free(delta->sent);
+        free(delta->valid);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* ========================================================================
+ = DELTA_EXPOSE
+ =
+ = The server lost an area of a window, resend it whatever it holds
+ ======================================================================= */
+
+void deltaExpose(delta_t *delta, int x, int y, int width, int height) {
+    int x2 = MIN(x + width, delta->width), y2 = MIN(y + height, delta->height);
+
+    x = MAX(x, 0);
+    y = MAX(y, 0);
+
+    for (int row = y; row < y2; row++)
+        if (x < x2)
+            memset(delta->valid + row * delta->width + x, 0, x2 - x);
+}
+
+
+/* ========================================================================
+ = DELTA_CHANGED
+ =
+ = Shrink a damaged area to the box around the pixels the windows do not
+ = show yet and record them as sent. Returns 0 if nothing changed.
+ ======================================================================= */
+
+int deltaChanged(delta_t *delta, int *x, int *y, int *width, int *height) {
+    int x1 = MAX(*x, 0), y1 = MAX(*y, 0);
+    int x2 = MIN(*x + *width, delta->width), y2 = MIN(*y + *height, delta->height);
+    int minX = x2, minY = y2, maxX = x1 - 1, maxY = y1 - 1;
+
+    for (int row = y1; row < y2; row++) {
+        for (int col = x1; col < x2; col++) {
+            int i = row * delta->width + col;
+            unsigned long pixel = XGetPixel(delta->shadow, col, row);
+
+            if (delta->valid[i] && delta->sent[i] == pixel)
+                continue;
+
+            delta->sent[i] = pixel;
+            delta->valid[i] = 1;
+            minX = MIN(minX, col);
+            minY = MIN(minY, row);
+            maxX = MAX(maxX, col);
+            maxY = MAX(maxY, row);
+        }
+    }
+
+    if (maxX < minX)
+        return 0;
+
+    *x = minX;
+    *y = minY;
+    *width = maxX - minX + 1;
+    *height = maxY - minY + 1;
+    return 1;
+}
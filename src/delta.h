@@ -0,0 +1,40 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DELTA_H__
+#define __DELTA_H__
+
+#include <X11/Xlib.h>
+
+/*
+ * Exact per-pixel change tracking for remote displays. The shadow mirrors
+ * the master pixmap, sent what the windows were last given, so a flush
+ * copies only the pixels that differ.
+ */
+typedef struct {
+    XImage *shadow;         // framebuffer image, kept equal to the master pixmap
+    unsigned long *sent;    // window pixels as last copied
+    unsigned char *valid;   // 0 where the windows may not show sent, e.g. exposed
+    int width, height;      // window area
+} delta_t;
+
+int deltaInit(delta_t *delta, XImage *shadow, int width, int height);
+void deltaExpose(delta_t *delta, int x, int y, int width, int height);
+int deltaChanged(delta_t *delta, int *x, int *y, int *width, int *height);
+
+#endif // __DELTA_H__
@@ -0,0 +1,339 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fnmatch.h>
+
+#include "sysmon.h"
+#include "disk.h"
+
+#define DISK_NAME_LEN 32
+
+
+/* ========================================================================
+ = NEXT_LONG
+ =
+ = Skip spaces and parse a decimal field
+ ======================================================================= */
+
+static inline const char *nextLong(const char *p, long int *value) {
+    long int v = 0;
+
+    while (*p == ' ') p++;
+    for (; *p >= '0' && *p <= '9'; p++)
+        v = v*10 + (*p - '0');
+
+    *value = v;
+    return p;
+}
+
+
+/* ========================================================================
+ = LINE_KEY
+ =
+ = Parse major:minor at the start of a diskstats line
+ ======================================================================= */
+
+static inline const char *lineKey(const char *p, unsigned int *key) {
+    long int major, minor;
+
+    p = nextLong(p, &major);
+    p = nextLong(p, &minor);
+    *key = (unsigned int)(major << 20 | minor);
+
+    return p;
+}
+
+
+/* ========================================================================
+ = LINE_WEIGHTED
+ =
+ = Weighted milliseconds doing IO, the 11th field after the device name
+ ======================================================================= */
+
+static const char *lineWeighted(const char *p, long int *weighted) {
+    long int unused;
+
+    while (*p == ' ') p++;
+    while (*p != ' ' && *p != '\n' && *p != '\0') p++;
+
+    for (int i = 0; i < 10; i++)
+        p = nextLong(p, &unused);
+
+    return nextLong(p, weighted);
+}
+
+
+/* ========================================================================
+ = DISK_MATCHES
+ =
+ = Test a device name against the configured filter
+ ======================================================================= */
+
+static int diskMatches(disk_table_t *disks, const char *p) {
+    char name[DISK_NAME_LEN];
+    size_t len;
+
+    while (*p == ' ') p++;
+    len = strcspn(p, " \n");
+    if (len == 0 || len >= sizeof(name))
+        return 0;
+
+    memcpy(name, p, len);
+    name[len] = '\0';
+
+    for (int i = 0; i < disks->patternCount; i++)
+        if (fnmatch(disks->patterns[i], name, 0) == 0)
+            return 1;
+
+    return 0;
+}
+
+
+/* ========================================================================
+ = DISK_SLOT
+ =
+ = Find a device in the open addressing table. When absent, returns
+ = -(free slot) - 1 so the caller can insert without probing again
+ ======================================================================= */
+
+static long diskSlot(disk_entry_t *table, size_t size, unsigned int key) {
+    unsigned int hash = key;
+    size_t slot;
+
+    // murmur3 finalizer, minors of one disk only differ in the low bits
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35U;
+    hash ^= hash >> 16;
+    slot = hash & (size - 1);
+
+    while (table[slot].used) {
+        if (table[slot].key == key)
+            return slot;
+        slot = (slot + 1) & (size - 1);
+    }
+
+    return -(long)slot - 1;
+}
+
+
+/* ========================================================================
+ = DISK_GROW
+ =
+ = Double the table and remap the monitored list to the new slots
+ ======================================================================= */
+
+static void diskGrow(disk_table_t *disks) {
+    size_t size = disks->size * 2;
+    disk_entry_t *table;
+
+    if ((table = calloc(size, sizeof(disk_entry_t))) == NULL) {
+        fprintf(stderr, "Cannot allocate disk table\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < disks->size; i++)
+        if (disks->table[i].used)
+            table[-diskSlot(table, size, disks->table[i].key) - 1] = disks->table[i];
+
+    for (int i = 0; i < disks->monitoredCount; i++)
+        disks->monitored[i] = diskSlot(table, size, disks->table[disks->monitored[i]].key);
+
+    free(disks->table);
+    disks->table = table;
+    disks->size = size;
+}
+
+
+/* ========================================================================
+ = DISK_MONITOR
+ =
+ = Append a table slot to the monitored list
+ ======================================================================= */
+
+static void diskMonitor(disk_table_t *disks, long slot) {
+    if (disks->monitoredCount == disks->monitoredSize) {
+        disks->monitoredSize = MAX(16, disks->monitoredSize * 2);
+        disks->monitored = realloc(disks->monitored, disks->monitoredSize * sizeof(int));
+        if (disks->monitored == NULL) {
+            fprintf(stderr, "Cannot allocate disk table\n");
+            exit(1);
+        }
+    }
+
+    disks->monitored[disks->monitoredCount++] = slot;
+}
+
+
+/* ========================================================================
+ = DISK_FULL_SCAN
+ =
+ = Walk every line, learning new devices and recording line offsets
+ ======================================================================= */
+
+static long int diskFullScan(disk_table_t *disks, const char *buf, size_t len) {
+    const char *p = buf, *end = buf + len;
+    long int total = 0;
+
+    disks->monitoredCount = 0;
+    disks->ticks = 0;
+
+    while (p < end) {
+        const char *line = p, *eol;
+        unsigned int key;
+        long slot;
+
+        p = lineKey(p, &key);
+        disks->linesScanned++;
+
+        if ((slot = diskSlot(disks->table, disks->size, key)) < 0) {
+            if ((disks->used + 1) * 2 > disks->size) {
+                diskGrow(disks);
+                slot = diskSlot(disks->table, disks->size, key);
+            }
+
+            slot = -slot - 1;
+            disks->table[slot].used = 1;
+            disks->table[slot].key = key;
+            disks->table[slot].monitored = diskMatches(disks, p);
+            disks->used++;
+        }
+
+        disks->table[slot].offset = line - buf;
+        if (disks->table[slot].monitored) {
+            long int weighted;
+
+            p = lineWeighted(p, &weighted);
+            total += MAX(0, weighted);
+            diskMonitor(disks, slot);
+        }
+
+        if ((eol = memchr(p, '\n', end - p)) == NULL)
+            break;
+        p = eol + 1;
+    }
+
+    return total;
+}
+
+
+/* ========================================================================
+ = DISK_INIT
+ =
+ = Set up an empty table, filter is a comma separated list of globs
+ ======================================================================= */
+
+void diskInit(disk_table_t *disks, const char *filter) {
+    char *pattern, *save;
+
+    memset(disks, 0, sizeof(disk_table_t));
+
+    disks->filter = strdup(filter ? filter : DISK_DEFAULT_FILTER);
+    disks->patterns = malloc((strlen(disks->filter) / 2 + 1) * sizeof(char *));
+    disks->size = DISK_TABLE_SIZE;
+    disks->table = calloc(disks->size, sizeof(disk_entry_t));
+
+    if (disks->filter == NULL || disks->patterns == NULL || disks->table == NULL) {
+        fprintf(stderr, "Cannot allocate disk table\n");
+        exit(1);
+    }
+
+    pattern = strtok_r(disks->filter, ",", &save);
+    for (; pattern != NULL; pattern = strtok_r(NULL, ",", &save))
+        disks->patterns[disks->patternCount++] = pattern;
+}
+
+
+/* ========================================================================
+ = DISK_WEIGHTED
+ =
+ = Sum weighted IO time of monitored devices. Between full scans only the
+ = remembered line offsets are visited; when earlier lines changed length
+ = the offset is resynced by walking forward from the previous device.
+ ======================================================================= */
+
+long int diskWeighted(disk_table_t *disks, const char *buf, size_t len) {
+    const char *end = buf + len;
+    size_t from = 0;
+    long shift = 0;
+    long int total = 0;
+
+    if (disks->used == 0 || ++disks->ticks >= DISK_RESCAN_TICKS)
+        return diskFullScan(disks, buf, len);
+
+    for (int i = 0; i < disks->monitoredCount; i++) {
+        disk_entry_t *entry = &disks->table[disks->monitored[i]];
+        size_t pos = entry->offset + shift;
+        const char *p = NULL, *eol;
+        unsigned int key;
+        long int weighted;
+
+        if (pos < len && (pos == 0 || buf[pos-1] == '\n')) {
+            p = lineKey(buf + pos, &key);
+            if (key != entry->key) p = NULL;
+        }
+
+        // line moved, look for it between the previous device and the end
+        for (const char *q = buf + from; p == NULL && q < end; ) {
+            const char *next = lineKey(q, &key);
+
+            disks->linesScanned++;
+            if (key == entry->key) {
+                pos = q - buf;
+                shift = (long)pos - (long)entry->offset;
+                p = next;
+                break;
+            }
+
+            if ((q = memchr(next, '\n', end - next)) == NULL)
+                break;
+            q++;
+        }
+
+        // device went away
+        if (p == NULL)
+            return diskFullScan(disks, buf, len);
+
+        entry->offset = pos;
+        p = lineWeighted(p, &weighted);
+        total += MAX(0, weighted);
+
+        if ((eol = memchr(p, '\n', end - p)) == NULL)
+            break;
+        from = eol + 1 - buf;
+    }
+
+    return total;
+}
+
+
+/* ========================================================================
+ = DISK_FREE
+ ======================================================================= */
+
+void diskFree(disk_table_t *disks) {
+    free(disks->table);
+    free(disks->monitored);
+    free(disks->patterns);
+    free(disks->filter);
+    memset(disks, 0, sizeof(disk_table_t));
+}
@@ -0,0 +1,58 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __DISK_H__
+#define __DISK_H__
+
+#include <stddef.h>
+
+#define DISK_TABLE_SIZE   64 // initial slots, grows by doubling
+#define DISK_RESCAN_TICKS 40 // full scan interval to pick up hotplugged devices
+
+// whole disks only, partitions and stacked devices would count IO twice;
+// sd and xvd names grow letters, their partitions end in a digit
+#define DISK_DEFAULT_FILTER \
+    "sd*[a-z],hd[a-z],vd*[a-z],xvd*[a-z]," \
+    "nvme[0-9]*n[0-9],nvme[0-9]*n[0-9][0-9],mmcblk[0-9],mmcblk[0-9][0-9]"
+
+typedef struct {
+    unsigned int key; // major << 20 | minor
+    int used;
+    int monitored;
+    size_t offset; // start of the device line in the last read
+} disk_entry_t;
+
+typedef struct {
+    disk_entry_t *table;
+    size_t size;
+    size_t used;
+    int *monitored; // table slots of monitored devices, in file order
+    int monitoredCount;
+    int monitoredSize;
+    char *filter;
+    char **patterns;
+    int patternCount;
+    int ticks;
+    unsigned long linesScanned;
+} disk_table_t;
+
+void diskInit(disk_table_t *disks, const char *filter);
+long int diskWeighted(disk_table_t *disks, const char *buf, size_t len);
+void diskFree(disk_table_t *disks);
+
+#endif // __DISK_H__
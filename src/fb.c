@@ -0,0 +1,219 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+#include "sysmon.h"
+#include "stats.h"
+#include "fb.h"
+
+
+/* ========================================================================
+ = FB_SHM_IMAGE
+ =
+ = Create the client image in a segment shared with the X server, returns
+ = NULL if MIT-SHM is missing or refuses, e.g. on a remote display
+ ======================================================================= */
+
+static XImage *fbShmImage(fb_t *fb, Visual *visual, int depth, int width, int height) {
+    XImage *image;
+
+    if (!XShmQueryExtension(fb->display))
+        return NULL;
+
+    image = XShmCreateImage(fb->display, visual, depth, ZPixmap, NULL, &fb->shm, width, height);
+    if (image == NULL)
+        return NULL;
+
+    fb->shm.shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0600);
+    if (fb->shm.shmid < 0) {
+        XDestroyImage(image);
+        return NULL;
+    }
+
+    fb->shm.shmaddr = image->data = shmat(fb->shm.shmid, NULL, 0);
+    fb->shm.readOnly = True;
+
+    // removed right away, it goes when both sides have detached
+    if (fb->shm.shmaddr == (void *)-1 || !XShmAttach(fb->display, &fb->shm)) {
+        shmctl(fb->shm.shmid, IPC_RMID, NULL);
+        image->data = NULL;
+        XDestroyImage(image);
+        return NULL;
+    }
+
+    XSync(fb->display, False);
+    shmctl(fb->shm.shmid, IPC_RMID, NULL);
+
+    return image;
+}
+
+
+/* ========================================================================
+ = FB_INIT
+ =
+ = Pull the master pixmap, sprites and view, into client memory once,
+ = through MIT-SHM if shm is set. Returns -1 if the pixel format is not
+ = one we can copy bytewise.
+ ======================================================================= */
+
+int fbInit(fb_t *fb, Display *display, Pixmap master, int width, int height, Window window, int shm) {
+    int screen = DefaultScreen(display);
+    Visual *visual = DefaultVisual(display, screen);
+    int depth = DefaultDepth(display, screen);
+
+    memset(fb, 0, sizeof(fb_t));
+    fb->display = display;
+
+    if (shm && (fb->image = fbShmImage(fb, visual, depth, width, height)) != NULL) {
+        XShmGetImage(display, master, fb->image, 0, 0, AllPlanes);
+        fb->useShm = 1;
+        fb->completion = XShmGetEventBase(display) + ShmCompletion;
+    }
+    else if ((fb->image = XGetImage(display, master, 0, 0, width, height, AllPlanes, ZPixmap)) == NULL) {
+        return -1;
+    }
+
+    if (fb->image->bits_per_pixel < 8 || fb->image->bits_per_pixel % 8) {
+        fprintf(stderr, "Framebuffer needs whole bytes per pixel, not %d bits\n", fb->image->bits_per_pixel);
+        if (fb->useShm) {
+            XShmDetach(display, &fb->shm);
+            shmdt(fb->shm.shmaddr);
+            fb->image->data = NULL;
+        }
+        XDestroyImage(fb->image);
+        fb->image = NULL;
+        return -1;
+    }
+    fb->bytesPerPixel = fb->image->bits_per_pixel / 8;
+
+    fb->gc = XCreateGC(display, window, 0, NULL);
+    XSetGraphicsExposures(display, fb->gc, False);
+
+    return 0;
+}
+
+
+/* ========================================================================
+ = FB_COPY
+ =
+ = Client side copyXPMArea, row by row within the image. Returns 1 if any
+ = destination pixel changed.
+ ======================================================================= */
+
+int fbCopy(fb_t *fb, int srcX, int srcY, int width, int height, int dstX, int dstY) {
+    XImage *image = fb->image;
+    int changed = 0;
+    size_t len;
+
+    if (width <= 0 || height <= 0)
+        return 0;
+
+    len = (size_t)width * fb->bytesPerPixel;
+    for (int y = 0; y < height; y++) {
+        char *dst = image->data + (dstY + y) * image->bytes_per_line + dstX * fb->bytesPerPixel;
+        const char *src = image->data + (srcY + y) * image->bytes_per_line + srcX * fb->bytesPerPixel;
+
+        if (!changed && memcmp(dst, src, len))
+            changed = 1;
+        memmove(dst, src, len);
+    }
+
+    return changed;
+}
+
+
+/* ========================================================================
+ = FB_DAMAGE
+ =
+ = Remember an area changed, the next flush uploads the bounding box
+ ======================================================================= */
+
+void fbDamage(fb_t *fb, int x, int y, int width, int height) {
+    if (!fb->dirty) {
+        fb->x1 = x;
+        fb->y1 = y;
+        fb->x2 = x + width;
+        fb->y2 = y + height;
+        fb->dirty = 1;
+        return;
+    }
+
+    fb->x1 = MIN(fb->x1, x);
+    fb->y1 = MIN(fb->y1, y);
+    fb->x2 = MAX(fb->x2, x + width);
+    fb->y2 = MAX(fb->y2, y + height);
+}
+
+
+/* ========================================================================
+ = FB_EVENT
+ =
+ = Follow when uploads complete
+ ======================================================================= */
+
+void fbEvent(fb_t *fb, const XEvent *event) {
+    if (fb->useShm && event->type == fb->completion)
+        fb->pending = MAX(0, fb->pending - 1);
+}
+
+
+/* ========================================================================
+ = FB_FLUSH
+ =
+ = Upload the damaged area to the given windows, returns the number of
+ = requests sent
+ ======================================================================= */
+
+int fbFlush(fb_t *fb, const Window *windows, int count) {
+    int width = fb->x2 - fb->x1, height = fb->y2 - fb->y1, requests = 0;
+
+    if (!fb->dirty)
+        return 0;
+
+    // the server still reads the previous frame, upload this one later
+    if (fb->pending > 0)
+        return 0;
+
+    for (int i = 0; i < count; i++) {
+        if (fb->useShm) {
+            XShmPutImage(fb->display, windows[i], fb->gc, fb->image,
+                fb->x1, fb->y1, fb->x1, fb->y1, width, height, True);
+            stats.xBytes += X_SHM_PUT_IMAGE_BYTES;
+            fb->pending++;
+        }
+        else {
+            XPutImage(fb->display, windows[i], fb->gc, fb->image,
+                fb->x1, fb->y1, fb->x1, fb->y1, width, height);
+            stats.xBytes += X_PUT_IMAGE_BYTES + (width * fb->image->bits_per_pixel + 31) / 32 * 4 * height;
+        }
+        requests++;
+    }
+
+    fb->dirty = 0;
+    fb->uploads += requests;
+    return requests;
+}
@@ -0,0 +1,45 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __FB_H__
+#define __FB_H__
+
+#include <X11/Xlib.h>
+#include <X11/extensions/XShm.h>
+
+typedef struct {
+    Display *display;
+    XImage *image;          // client copy of the master pixmap, view at 0,0
+    XShmSegmentInfo shm;
+    int useShm;
+    int completion;         // ShmCompletion event type
+    int pending;            // uploads the server has not finished reading
+    GC gc;
+    int bytesPerPixel;
+    int dirty;
+    int x1, y1, x2, y2;     // damaged area since the last flush
+    unsigned long uploads;
+} fb_t;
+
+int fbInit(fb_t *fb, Display *display, Pixmap master, int width, int height, Window window, int shm);
+int fbCopy(fb_t *fb, int srcX, int srcY, int width, int height, int dstX, int dstY);
+void fbDamage(fb_t *fb, int x, int y, int width, int height);
+void fbEvent(fb_t *fb, const XEvent *event);
+int fbFlush(fb_t *fb, const Window *windows, int count);
+
+#endif // __FB_H__
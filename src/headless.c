@@ -0,0 +1,220 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+
+#include "sysmon.h"
+#include "psi.h"
+#include "headless.h"
+
+#define CSV_HEADER "time,cpu,user,sys,iowait,steal,mem,mem_used,mem_total," \
+    "io,rx_bytes,tx_bytes,load1,load5,load15,psi_cpu,psi_mem,psi_io\n"
+
+
+/* ========================================================================
+ = HEADLESS_FORMAT
+ =
+ = Map a format name to HEADLESS_*, returns -1 if unknown
+ ======================================================================= */
+
+int headlessFormat(const char *name) {
+    if (!strcmp(name, "csv"))
+        return HEADLESS_CSV;
+    if (!strcmp(name, "json"))
+        return HEADLESS_JSON;
+    return -1;
+}
+
+
+/* ========================================================================
+ = HEADLESS_WRITE
+ =
+ = Write out the buffer, a closed pipe or full disk ends the program
+ ======================================================================= */
+
+static void headlessWrite(headless_t *headless) {
+    const char *p = headless->buf;
+    size_t left = headless->len;
+
+    // a single write unless a pipe reader is slow
+    while (left > 0) {
+        ssize_t n = write(headless->fd, p, left);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            fprintf(stderr, "Cannot write samples: %s\n", strerror(errno));
+            exit(1);
+        }
+        p += n;
+        left -= n;
+    }
+
+    headless->len = 0;
+}
+
+
+/* ========================================================================
+ = HEADLESS_OPEN
+ =
+ = Stream records to path, stdout when path is NULL or "-"
+ ======================================================================= */
+
+void headlessOpen(headless_t *headless, int format, const char *path) {
+    memset(headless, 0, sizeof(headless_t));
+    headless->format = format;
+    headless->fd = STDOUT_FILENO;
+
+    if (path != NULL && strcmp(path, "-")) {
+        headless->fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (headless->fd < 0) {
+            fprintf(stderr, "Cannot open '%s': %s\n", path, strerror(errno));
+            exit(1);
+        }
+    }
+
+    // appending to a file that already has records keeps its header
+    if (format == HEADLESS_CSV && lseek(headless->fd, 0, SEEK_END) <= 0) {
+        headless->len = strlen(CSV_HEADER);
+        memcpy(headless->buf, CSV_HEADER, headless->len);
+        headlessWrite(headless);
+    }
+}
+
+
+/* ========================================================================
+ = HEADLESS_UPDATE
+ =
+ = Remember the newest sample of its kind for the next record
+ ======================================================================= */
+
+void headlessUpdate(headless_t *headless, const sample_t *sample) {
+    memcpy(&headless->latest[sample->task], sample, sizeof(sample_t));
+    headless->have[sample->task] = 1;
+}
+
+
+/* ========================================================================
+ = HEADLESS_PRINTF
+ =
+ = Append to the record, output that does not fit is cut off
+ ======================================================================= */
+
+static void headlessPrintf(headless_t *headless, const char *format, ...) {
+    size_t room = HEADLESS_BUF_SIZE - headless->len;
+    va_list args;
+    int len;
+
+    va_start(args, format);
+    len = vsnprintf(headless->buf + headless->len, room, format, args);
+    va_end(args);
+
+    if (len > 0)
+        headless->len += MIN((size_t)len, room - 1);
+}
+
+
+/* ========================================================================
+ = HEADLESS_EMIT
+ =
+ = Format one record of the latest values and write it. Values not sampled
+ = yet are left empty in CSV and null in JSON.
+ ======================================================================= */
+
+void headlessEmit(headless_t *headless) {
+    const sample_t *cpu = headless->have[TASK_CPU] ? &headless->latest[TASK_CPU] : NULL;
+    const sample_t *mem = headless->have[TASK_MEM] ? &headless->latest[TASK_MEM] : NULL;
+    const sample_t *io = headless->have[TASK_IO] ? &headless->latest[TASK_IO] : NULL;
+    const sample_t *net = headless->have[TASK_NET] ? &headless->latest[TASK_NET] : NULL;
+    const sample_t *load = headless->have[TASK_LOADAVG] ? &headless->latest[TASK_LOADAVG] : NULL;
+    const sample_t *psi = headless->have[TASK_PSI] ? &headless->latest[TASK_PSI] : NULL;
+    int json = headless->format == HEADLESS_JSON;
+    const char *none = json ? "null" : "";
+    struct timespec ts;
+
+    // wall clock, records are meant to be lined up with other logs
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    if (io != NULL && io->io.percent < 0)
+        io = NULL;
+
+    if (json) {
+        headlessPrintf(headless, "{\"time\":%lld.%03ld,", (long long)ts.tv_sec, ts.tv_nsec / 1000000);
+        if (cpu != NULL)
+            headlessPrintf(headless, "\"cpu\":%d,\"user\":%d,\"sys\":%d,\"iowait\":%d,\"steal\":%d,",
+                cpu->cpu.total, cpu->cpu.amounts[0], cpu->cpu.amounts[1],
+                cpu->cpu.amounts[2], cpu->cpu.amounts[3]);
+        else
+            headlessPrintf(headless, "\"cpu\":null,\"user\":null,\"sys\":null,\"iowait\":null,\"steal\":null,");
+    }
+    else {
+        headlessPrintf(headless, "%lld.%03ld,", (long long)ts.tv_sec, ts.tv_nsec / 1000000);
+        if (cpu != NULL)
+            headlessPrintf(headless, "%d,%d,%d,%d,%d,", cpu->cpu.total, cpu->cpu.amounts[0],
+                cpu->cpu.amounts[1], cpu->cpu.amounts[2], cpu->cpu.amounts[3]);
+        else
+            headlessPrintf(headless, ",,,,,");
+    }
+
+    if (mem != NULL)
+        headlessPrintf(headless, json ? "\"mem\":%d,\"mem_used\":%lld,\"mem_total\":%lld," : "%d,%lld,%lld,",
+            mem->mem.percent, mem->mem.used, mem->mem.total);
+    else
+        headlessPrintf(headless, json ? "\"mem\":null,\"mem_used\":null,\"mem_total\":null," : ",,,");
+
+    if (io != NULL)
+        headlessPrintf(headless, json ? "\"io\":%d," : "%d,", io->io.percent);
+    else
+        headlessPrintf(headless, json ? "\"io\":%s," : "%s,", none);
+
+    if (net != NULL)
+        headlessPrintf(headless, json ? "\"rx_bytes\":%llu,\"tx_bytes\":%llu," : "%llu,%llu,",
+            net->net.rx, net->net.tx);
+    else
+        headlessPrintf(headless, json ? "\"rx_bytes\":null,\"tx_bytes\":null," : ",,");
+
+    if (load != NULL)
+        headlessPrintf(headless, json ? "\"load1\":%.2f,\"load5\":%.2f,\"load15\":%.2f" : "%.2f,%.2f,%.2f",
+            load->loadavg[0], load->loadavg[1], load->loadavg[2]);
+    else
+        headlessPrintf(headless, json ? "\"load1\":null,\"load5\":null,\"load15\":null" : ",,");
+
+    for (int i = 0; i < PSI_COUNT; i++) {
+        static const char *names[PSI_COUNT] = { "psi_cpu", "psi_mem", "psi_io" };
+
+        if (json)
+            headlessPrintf(headless, ",\"%s\":", names[i]);
+        else
+            headlessPrintf(headless, ",");
+
+        if (psi != NULL && psi->pressure.avg10[i] >= 0)
+            headlessPrintf(headless, "%.2f", psi->pressure.avg10[i]);
+        else
+            headlessPrintf(headless, "%s", none);
+    }
+
+    headlessPrintf(headless, json ? "}\n" : "\n");
+    headlessWrite(headless);
+}
@@ -0,0 +1,47 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __HEADLESS_H__
+#define __HEADLESS_H__
+
+#include <stddef.h>
+
+#include "sysmon.h"
+
+#define HEADLESS_BUF_SIZE 1024 // one record, header included
+
+enum {
+    HEADLESS_CSV,
+    HEADLESS_JSON
+};
+
+typedef struct {
+    int fd;                 // -1 when rendering to X
+    int format;
+    sample_t latest[TASK_COUNT];
+    int have[TASK_COUNT];
+    char buf[HEADLESS_BUF_SIZE];
+    size_t len;
+} headless_t;
+
+int headlessFormat(const char *name);
+void headlessOpen(headless_t *headless, int format, const char *path);
+void headlessUpdate(headless_t *headless, const sample_t *sample);
+void headlessEmit(headless_t *headless);
+
+#endif // __HEADLESS_H__
@@ -0,0 +1,290 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sysmon.h"
+#include "history.h"
+
+const long long histPeriodMs[HIST_TIERS] = {
+    [HIST_1S] = 1000, [HIST_10S] = 10000, [HIST_1M] = 60000, [HIST_10M] = 600000
+};
+
+const char *histMetricNames[HIST_METRICS] = {
+    [HIST_CPU] = "cpu", [HIST_MEM] = "mem", [HIST_IO] = "io", [HIST_LOAD] = "loadavg"
+};
+
+const char *histTierNames[HIST_TIERS] = {
+    [HIST_1S] = "1 s", [HIST_10S] = "10 s", [HIST_1M] = "1 min", [HIST_10M] = "10 min"
+};
+
+
+/* ========================================================================
+ = HISTORY_INIT
+ =
+ = Every tier empty, waiting for its first sample
+ ======================================================================= */
+
+void historyInit(history_t *history) {
+    memset(history, 0, sizeof(history_t));
+
+    for (int i = 0; i < HIST_METRICS; i++)
+        for (int j = 0; j < HIST_TIERS; j++)
+            history->tiers[i][j].slot = -1;
+}
+
+
+/* ========================================================================
+ = HISTORY_ADD
+ =
+ = Roll a sample into the bucket of its period on every tier, starting
+ = empty buckets for periods that went by without one. O(1) per tier.
+ = A sample outside the ring's span in either direction starts it over.
+ ======================================================================= */
+
+void historyAdd(history_t *history, int metric, long long stamp, float value) {
+    for (int i = 0; i < HIST_TIERS; i++) {
+        hist_tier_t *tier = &history->tiers[metric][i];
+        long long slot = stamp / histPeriodMs[i];
+        hist_bucket_t *bucket;
+
+        // a clock stepped that far either way leaves nothing worth keeping,
+        // backwards the ring would otherwise stay frozen until it catches up
+        if (tier->slot < 0 || slot - tier->slot >= HIST_LEN || tier->slot - slot >= HIST_LEN) {
+            memset(tier->buckets, 0, sizeof(tier->buckets));
+            tier->slot = slot;
+        }
+
+        for (; tier->slot < slot; tier->slot++)
+            memset(&tier->buckets[(tier->slot + 1) % HIST_LEN], 0, sizeof(hist_bucket_t));
+
+        bucket = &tier->buckets[slot % HIST_LEN];
+        if (bucket->count == 0 || value < bucket->min)
+            bucket->min = value;
+        if (bucket->count == 0 || value > bucket->max)
+            bucket->max = value;
+        bucket->sum += value;
+        bucket->count++;
+    }
+}
+
+
+/* ========================================================================
+ = HISTORY_COLUMNS
+ =
+ = Average and peak of the HIST_LEN periods up to now, oldest first, for
+ = drawing. A period without samples repeats the one before. Returns the
+ = highest peak. O(HIST_LEN).
+ ======================================================================= */
+
+float historyColumns(const history_t *history, int metric, int tier, long long now, float *avg, float *peak) {
+    const hist_tier_t *rings = &history->tiers[metric][tier];
+    long long last = now / histPeriodMs[tier];
+    float lastAvg = 0.0F, lastPeak = 0.0F, max = 0.0F;
+
+    for (int i = 0; i < HIST_LEN; i++) {
+        long long slot = last - HIST_LEN + 1 + i;
+        const hist_bucket_t *bucket = &rings->buckets[((slot % HIST_LEN) + HIST_LEN) % HIST_LEN];
+
+        // the bucket holds this period only if the ring has reached it
+        if (rings->slot >= 0 && slot <= rings->slot && rings->slot - slot < HIST_LEN && bucket->count > 0) {
+            lastAvg = bucket->sum / bucket->count;
+            lastPeak = bucket->max;
+        }
+
+        avg[i] = lastAvg;
+        peak[i] = lastPeak;
+        max = MAX(max, lastPeak);
+    }
+
+    return max;
+}
+
+
+/* ========================================================================
+ = HISTORY_RECENT
+ =
+ = Averages of the periods among the last HIST_LEN that have samples,
+ = oldest first, gaps squeezed out. Returns how many.
+ ======================================================================= */
+
+int historyRecent(const history_t *history, int metric, int tier, long long now, float *avg) {
+    const hist_tier_t *rings = &history->tiers[metric][tier];
+    long long last = now / histPeriodMs[tier];
+    int count = 0;
+
+    if (rings->slot < 0)
+        return 0;
+
+    for (long long slot = last - HIST_LEN + 1; slot <= last; slot++) {
+        const hist_bucket_t *bucket = &rings->buckets[((slot % HIST_LEN) + HIST_LEN) % HIST_LEN];
+
+        if (slot <= rings->slot && rings->slot - slot < HIST_LEN && bucket->count > 0)
+            avg[count++] = bucket->sum / bucket->count;
+    }
+
+    return count;
+}
+
+
+/* ========================================================================
+ = HISTORY_PATH
+ =
+ = $XDG_STATE_HOME/sysmon/history, ~/.local/state by default, creating
+ = the directories on the way. Returns -1 without a home.
+ ======================================================================= */
+
+int historyPath(char *path, size_t size) {
+    const char *state = getenv("XDG_STATE_HOME");
+    const char *home = getenv("HOME");
+    int len;
+
+    // the spec says relative paths are invalid and must be ignored
+    if (state != NULL && state[0] == '/')
+        len = snprintf(path, size, "%s/%s/%s", state, HIST_DIR, HIST_FILE);
+    else if (home != NULL && home[0] != '\0')
+        len = snprintf(path, size, "%s/.local/state/%s/%s", home, HIST_DIR, HIST_FILE);
+    else
+        return -1;
+
+    if (len < 0 || (size_t)len >= size)
+        return -1;
+
+    // mkdir -p of everything up to the file name
+    for (char *slash = strchr(path + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        if (mkdir(path, 0700) < 0 && errno != EEXIST) {
+            *slash = '/';
+            return -1;
+        }
+        *slash = '/';
+    }
+
+    return 0;
+}
+
+
+/* ========================================================================
+ = HISTORY_VALID
+ =
+ = Whether a mapped file was written with this layout
+ ======================================================================= */
+
+int historyValid(const hist_file_t *file, size_t size) {
+    return size == sizeof(hist_file_t) &&
+        !memcmp(file->magic, HIST_MAGIC, sizeof(file->magic)) &&
+        file->version == HIST_VERSION &&
+        file->size == sizeof(hist_file_t) &&
+        file->len == HIST_LEN &&
+        file->metrics == HIST_METRICS &&
+        file->tiers == HIST_TIERS;
+}
+
+
+/* ========================================================================
+ = HISTORY_MAP
+ =
+ = Map the history file shared and writable, starting it over when it has
+ = another layout. Returns the rings to record into, or NULL when the file
+ = cannot be used or another instance is recording into it.
+ ======================================================================= */
+
+history_t *historyMap(hist_map_t *map, const char *path) {
+    hist_file_t *file;
+    struct stat st;
+    int fd;
+
+    memset(map, 0, sizeof(hist_map_t));
+
+    if ((fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600)) < 0)
+        return NULL;
+
+    // held for as long as the process lives, the fd stays open for it
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0 || fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    if (st.st_size != sizeof(hist_file_t) && ftruncate(fd, sizeof(hist_file_t)) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    file = mmap(NULL, sizeof(hist_file_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (file == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    // the magic goes last, a crash before it only costs the history
+    if (st.st_size != sizeof(hist_file_t) || !historyValid(file, sizeof(hist_file_t))) {
+        memset(file->magic, 0, sizeof(file->magic));
+        historyInit(&file->history);
+        file->version = HIST_VERSION;
+        file->size = sizeof(hist_file_t);
+        file->len = HIST_LEN;
+        file->metrics = HIST_METRICS;
+        file->tiers = HIST_TIERS;
+        file->pad = 0;
+        memcpy(file->magic, HIST_MAGIC, sizeof(file->magic));
+        msync(file, sizeof(hist_file_t), MS_SYNC);
+    }
+
+    map->file = file;
+    return &file->history;
+}
+
+
+/* ========================================================================
+ = HISTORY_SYNC
+ =
+ = Start writing the rings back now and then, in between they are plain
+ = stores into the page cache that a crash of ours never loses
+ ======================================================================= */
+
+void historySync(hist_map_t *map, long long now) {
+    if (map->file == NULL || now - map->synced < HIST_SYNC_MS)
+        return;
+
+    msync(map->file, sizeof(hist_file_t), MS_ASYNC);
+    map->synced = now;
+}
+
+
+/* ========================================================================
+ = HISTORY_UNMAP
+ =
+ = Write the rings back and let go of the file
+ ======================================================================= */
+
+void historyUnmap(hist_map_t *map) {
+    if (map->file == NULL)
+        return;
+
+    msync(map->file, sizeof(hist_file_t), MS_SYNC);
+    munmap(map->file, sizeof(hist_file_t));
+    map->file = NULL;
+}
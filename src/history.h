@@ -0,0 +1,95 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __HISTORY_H__
+#define __HISTORY_H__
+
+#include "sysmon.h"
+
+#define HIST_LEN LOAD_HIST_LEN // buckets per tier, one per graph column
+
+#define HIST_MAGIC    "SYSMONH"   // 8 bytes with the terminator
+#define HIST_VERSION  1           // bump when hist_file_t changes
+#define HIST_SYNC_MS  60000       // written back at most this late
+#define HIST_DIR      "sysmon"    // under $XDG_STATE_HOME
+#define HIST_FILE     "history"
+
+enum {
+    HIST_CPU,
+    HIST_MEM,
+    HIST_IO,    // disk IO, or network with --net
+    HIST_LOAD,
+    HIST_METRICS
+};
+
+enum {
+    HIST_1S,
+    HIST_10S,
+    HIST_1M,
+    HIST_10M,
+    HIST_TIERS
+};
+
+typedef struct {
+    float min, max, sum;
+    unsigned int count;     // 0 for a period without samples
+} hist_bucket_t;
+
+// ring of the last HIST_LEN periods, slot is the period number of the newest
+typedef struct {
+    long long slot;
+    hist_bucket_t buckets[HIST_LEN];
+} hist_tier_t;
+
+typedef struct {
+    hist_tier_t tiers[HIST_METRICS][HIST_TIERS];
+} history_t;
+
+// what is on disk, stamps are CLOCK_REALTIME milliseconds so the rings
+// line up across restarts and reboots
+typedef struct {
+    char magic[8];
+    unsigned int version;
+    unsigned int size;      // sizeof(hist_file_t)
+    unsigned int len;       // HIST_LEN, differs between the two sizes
+    unsigned int metrics;
+    unsigned int tiers;
+    unsigned int pad;
+    history_t history;
+} hist_file_t;
+
+typedef struct {
+    hist_file_t *file;      // NULL when not persisted
+    long long synced;       // last msync
+} hist_map_t;
+
+extern const long long histPeriodMs[HIST_TIERS];
+extern const char *histMetricNames[HIST_METRICS];
+extern const char *histTierNames[HIST_TIERS];
+
+void historyInit(history_t *history);
+void historyAdd(history_t *history, int metric, long long stamp, float value);
+float historyColumns(const history_t *history, int metric, int tier, long long now, float *avg, float *peak);
+int historyRecent(const history_t *history, int metric, int tier, long long now, float *avg);
+int historyPath(char *path, size_t size);
+int historyValid(const hist_file_t *file, size_t size);
+history_t *historyMap(hist_map_t *map, const char *path);
+void historySync(hist_map_t *map, long long now);
+void historyUnmap(hist_map_t *map);
+
+#endif // __HISTORY_H__
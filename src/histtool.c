@@ -0,0 +1,214 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sysmon.h"
+#include "history.h"
+
+static const char *tierArgs[HIST_TIERS] = {
+    [HIST_1S] = "1s", [HIST_10S] = "10s", [HIST_1M] = "1m", [HIST_10M] = "10m"
+};
+
+
+/* ========================================================================
+ = USAGE
+ =
+ = Print command line help and exit
+ ======================================================================= */
+
+void usage(const char *name) {
+    fprintf(stderr, "usage: %s [options] [file]\n", name);
+    fprintf(stderr, "  --tier 1s|10s|1m|10m     only this tier (replay default: 10s)\n");
+    fprintf(stderr, "  --replay                 every metric per period in time order, as\n");
+    fprintf(stderr, "                           CSV, instead of the rings one by one\n");
+    fprintf(stderr, "  file                     default: $XDG_STATE_HOME/sysmon/history\n");
+    exit(1);
+}
+
+
+/* ========================================================================
+ = FORMAT_TIME
+ =
+ = Local time of a period start, stamps are CLOCK_REALTIME milliseconds
+ ======================================================================= */
+
+const char *formatTime(long long stamp) {
+    static char buf[32];
+    time_t seconds = stamp / 1000;
+    struct tm tm;
+
+    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime_r(&seconds, &tm));
+    return buf;
+}
+
+
+/* ========================================================================
+ = PERIOD_BUCKET
+ =
+ = Bucket of a period if the ring still holds it and it has samples
+ ======================================================================= */
+
+const hist_bucket_t *periodBucket(const hist_tier_t *tier, long long slot) {
+    const hist_bucket_t *bucket;
+
+    if (tier->slot < 0 || slot > tier->slot || tier->slot - slot >= HIST_LEN)
+        return NULL;
+
+    bucket = &tier->buckets[slot % HIST_LEN];
+    return bucket->count > 0 ? bucket : NULL;
+}
+
+
+/* ========================================================================
+ = DUMP_TIER
+ =
+ = Every period of one ring with samples, oldest first
+ ======================================================================= */
+
+void dumpTier(const history_t *history, int metric, int tier) {
+    const hist_tier_t *rings = &history->tiers[metric][tier];
+
+    for (long long slot = rings->slot - HIST_LEN + 1; rings->slot >= 0 && slot <= rings->slot; slot++) {
+        const hist_bucket_t *bucket = periodBucket(rings, slot);
+
+        if (bucket != NULL)
+            printf("%-7s %-6s %s  min %8.2f  avg %8.2f  max %8.2f  samples %u\n",
+                histMetricNames[metric], histTierNames[tier], formatTime(slot * histPeriodMs[tier]),
+                bucket->min, bucket->sum / bucket->count, bucket->max, bucket->count);
+    }
+}
+
+
+/* ========================================================================
+ = REPLAY_TIER
+ =
+ = The periods of a tier in time order, one CSV row with the average of
+ = every metric each, empty where a metric has no samples
+ ======================================================================= */
+
+void replayTier(const history_t *history, int tier) {
+    long long first = -1, last = -1;
+
+    for (int i = 0; i < HIST_METRICS; i++) {
+        const hist_tier_t *rings = &history->tiers[i][tier];
+
+        if (rings->slot < 0)
+            continue;
+        if (first < 0 || rings->slot - HIST_LEN + 1 < first)
+            first = MAX(0, rings->slot - HIST_LEN + 1);
+        last = MAX(last, rings->slot);
+    }
+
+    printf("time");
+    for (int i = 0; i < HIST_METRICS; i++)
+        printf(",%s", histMetricNames[i]);
+    printf("\n");
+
+    for (long long slot = first; first >= 0 && slot <= last; slot++) {
+        const hist_bucket_t *buckets[HIST_METRICS];
+        int any = 0;
+
+        for (int i = 0; i < HIST_METRICS; i++)
+            any |= (buckets[i] = periodBucket(&history->tiers[i][tier], slot)) != NULL;
+
+        if (!any)
+            continue;
+
+        printf("%s", formatTime(slot * histPeriodMs[tier]));
+        for (int i = 0; i < HIST_METRICS; i++) {
+            if (buckets[i] != NULL)
+                printf(",%.2f", buckets[i]->sum / buckets[i]->count);
+            else
+                printf(",");
+        }
+        printf("\n");
+    }
+}
+
+
+/* ========================================================================
+ = MAIN
+ =
+ = Dump or replay a history file written by sysmon
+ ======================================================================= */
+
+int main(int argc, char *argv[]) {
+    char path[PATH_MAX] = "";
+    const hist_file_t *file;
+    int replay = 0, tier = -1, fd;
+    struct stat st;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--replay")) {
+            replay = 1;
+        }
+        else if (!strcmp(argv[i], "--tier") && i+1 < argc) {
+            for (tier = 0; tier < HIST_TIERS && strcmp(argv[i+1], tierArgs[tier]); tier++);
+            if (tier == HIST_TIERS)
+                usage(argv[0]);
+            i++;
+        }
+        else if (argv[i][0] != '-' && path[0] == '\0') {
+            snprintf(path, sizeof(path), "%s", argv[i]);
+        }
+        else {
+            usage(argv[0]);
+        }
+    }
+
+    if (path[0] == '\0' && historyPath(path, sizeof(path)) < 0) {
+        fprintf(stderr, "No state directory, give the history file\n");
+        return 1;
+    }
+
+    // read only, sysmon may be recording into it right now
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    file = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (st.st_size == 0 || file == MAP_FAILED || !historyValid(file, st.st_size)) {
+        fprintf(stderr, "%s is not a history file of this build\n", path);
+        return 1;
+    }
+
+    if (replay) {
+        replayTier(&file->history, tier < 0 ? HIST_10S : tier);
+        return 0;
+    }
+
+    for (int i = 0; i < HIST_METRICS; i++)
+        for (int j = 0; j < HIST_TIERS; j++)
+            if (tier < 0 || j == tier)
+                dumpTier(&file->history, i, j);
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "sysmon.h"
+#include "loadavg.h"
+
+
+/* ========================================================================
+ = LOAD_AVG_PUSH
+ =
+ = Append a value to the history ring. The deque keeps the window maximum
+ = at its front, so the graph scale costs O(1) amortized per sample.
+ ======================================================================= */
+
+void loadAvgPush(loadavg_t *loadavg, float value) {
+    int slot = loadavg->index;
+
+    // the oldest value leaves the window, it can only be at the front
+    if (loadavg->isWrapped && loadavg->dequeLen > 0 && loadavg->deque[loadavg->dequeHead] == slot) {
+        loadavg->dequeHead = (loadavg->dequeHead + 1) % LOAD_HIST_LEN;
+        loadavg->dequeLen--;
+    }
+
+    // values not above the new one can never be the maximum again
+    while (loadavg->dequeLen > 0) {
+        int back = loadavg->deque[(loadavg->dequeHead + loadavg->dequeLen - 1) % LOAD_HIST_LEN];
+
+        if (loadavg->history[back] > value)
+            break;
+        loadavg->dequeLen--;
+    }
+
+    loadavg->deque[(loadavg->dequeHead + loadavg->dequeLen) % LOAD_HIST_LEN] = slot;
+    loadavg->dequeLen++;
+
+    loadavg->history[slot] = value;
+    loadavg->count++;
+
+    if (++loadavg->index >= LOAD_HIST_LEN) {
+        loadavg->index = 0;
+        loadavg->isWrapped = 1;
+    }
+}
+
+
+/* ========================================================================
+ = LOAD_AVG_MAX
+ =
+ = Graph scale, the highest value in the history but at least 1
+ ======================================================================= */
+
+float loadAvgMax(const loadavg_t *loadavg) {
+    if (loadavg->dequeLen == 0)
+        return 1.0F;
+
+    return MAX(1.0F, loadavg->history[loadavg->deque[loadavg->dequeHead]]);
+}
+
+
+/* ========================================================================
+ = LOAD_AVG_LATEST
+ =
+ = Most recently pushed value
+ ======================================================================= */
+
+float loadAvgLatest(const loadavg_t *loadavg) {
+    return loadavg->history[(loadavg->index + LOAD_HIST_LEN - 1) % LOAD_HIST_LEN];
+}
@@ -0,0 +1,28 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __LOADAVG_H__
+#define __LOADAVG_H__
+
+#include "sysmon.h"
+
+void loadAvgPush(loadavg_t *loadavg, float value);
+float loadAvgMax(const loadavg_t *loadavg);
+float loadAvgLatest(const loadavg_t *loadavg);
+
+#endif // __LOADAVG_H__
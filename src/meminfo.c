@@ -0,0 +1,100 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "sysmon.h"
+#include "meminfo.h"
+
+#define MEMINFO_ALL ((1 << (sizeof(meminfoKeys) / sizeof(meminfoKeys[0]))) - 1)
+
+static const struct {
+    const char *key;
+    size_t len;
+    size_t offset;
+} meminfoKeys[] = {
+    // same order as the flags in meminfo.h
+    { "MemTotal",     8,  offsetof(meminfo_t, total) },
+    { "MemFree",      7,  offsetof(meminfo_t, free) },
+    { "MemAvailable", 12, offsetof(meminfo_t, available) },
+    { "Buffers",      7,  offsetof(meminfo_t, buffers) },
+    { "Cached",       6,  offsetof(meminfo_t, cached) },
+    { "Shmem",        5,  offsetof(meminfo_t, shmem) },
+    { "SReclaimable", 12, offsetof(meminfo_t, sreclaimable) },
+    { "SwapTotal",    9,  offsetof(meminfo_t, swapTotal) },
+    { "SwapFree",     8,  offsetof(meminfo_t, swapFree) }
+};
+
+
+/* ========================================================================
+ = PARSE_MEMINFO
+ =
+ = Single pass over /proc/meminfo, stops once every known key was seen
+ ======================================================================= */
+
+int parseMeminfo(const char *buf, size_t len, meminfo_t *info) {
+    const char *p = buf, *end = buf + len;
+
+    memset(info, 0, sizeof(meminfo_t));
+
+    while (p < end && info->found != MEMINFO_ALL) {
+        const char *colon, *eol;
+        size_t keylen;
+
+        if ((colon = memchr(p, ':', end - p)) == NULL)
+            break;
+
+        keylen = colon - p;
+        for (unsigned int i = 0; i < sizeof(meminfoKeys) / sizeof(meminfoKeys[0]); i++) {
+            long int value = 0;
+
+            if (keylen != meminfoKeys[i].len || (info->found & (1 << i)))
+                continue;
+            if (memcmp(p, meminfoKeys[i].key, keylen))
+                continue;
+
+            for (p = colon + 1; p < end && *p == ' '; p++);
+            for (; p < end && *p >= '0' && *p <= '9'; p++)
+                value = value*10 + (*p - '0');
+
+            *(long int *)((char *)info + meminfoKeys[i].offset) = value;
+            info->found |= 1 << i;
+            break;
+        }
+
+        if ((eol = memchr(colon, '\n', end - colon)) == NULL)
+            break;
+        p = eol + 1;
+    }
+
+    return (info->found & MEMINFO_REQUIRED) == MEMINFO_REQUIRED ? 0 : -1;
+}
+
+
+/* ========================================================================
+ = MEM_USED
+ =
+ = Used memory in kB, kernels before 3.14 lack MemAvailable
+ ======================================================================= */
+
+long int memUsed(const meminfo_t *info, int mode) {
+    if (mode == MEM_USED_AVAILABLE && (info->found & MEMINFO_AVAILABLE))
+        return MAX(0, info->total - info->available);
+
+    return MAX(0, info->total - (info->free + info->buffers + info->cached));
+}
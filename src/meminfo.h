@@ -0,0 +1,60 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __MEMINFO_H__
+#define __MEMINFO_H__
+
+#include <stddef.h>
+
+// all values are in kB, as reported by the kernel
+typedef struct {
+    long int total;
+    long int free;
+    long int available;
+    long int buffers;
+    long int cached;
+    long int shmem;
+    long int sreclaimable;
+    long int swapTotal;
+    long int swapFree;
+    unsigned int found;
+} meminfo_t;
+
+enum {
+    MEMINFO_TOTAL        = 1 << 0,
+    MEMINFO_FREE         = 1 << 1,
+    MEMINFO_AVAILABLE    = 1 << 2,
+    MEMINFO_BUFFERS      = 1 << 3,
+    MEMINFO_CACHED       = 1 << 4,
+    MEMINFO_SHMEM        = 1 << 5,
+    MEMINFO_SRECLAIMABLE = 1 << 6,
+    MEMINFO_SWAP_TOTAL   = 1 << 7,
+    MEMINFO_SWAP_FREE    = 1 << 8
+};
+
+#define MEMINFO_REQUIRED (MEMINFO_TOTAL | MEMINFO_FREE | MEMINFO_BUFFERS | MEMINFO_CACHED)
+
+enum {
+    MEM_USED_AVAILABLE, // total - available
+    MEM_USED_CLASSIC    // total - (free + buffers + cached)
+};
+
+int parseMeminfo(const char *buf, size_t len, meminfo_t *info);
+long int memUsed(const meminfo_t *info, int mode);
+
+#endif // __MEMINFO_H__
@@ -0,0 +1,352 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE // accept4
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "sysmon.h"
+#include "psi.h"
+#include "metrics.h"
+
+static const char *cpuModes[] = {
+    "user", "nice", "system", "idle", "iowait", "irq", "softirq", "steal"
+};
+
+static const char *pressureResources[PSI_COUNT] = { "cpu", "memory", "io" };
+
+
+/* ========================================================================
+ = METRICS_OPEN
+ =
+ = Listen on a Unix socket, a stale socket left behind is replaced
+ ======================================================================= */
+
+void metricsOpen(metrics_t *metrics, const char *path) {
+    struct sockaddr_un addr;
+    struct stat st;
+
+    struct epoll_event event = { .events = EPOLLIN, .data.u32 = METRICS_CLIENTS };
+
+    memset(metrics, 0, sizeof(metrics_t));
+    metrics->fd = -1;
+    metrics->pollFd = -1;
+    for (int i = 0; i < METRICS_CLIENTS; i++)
+        metrics->clients[i].fd = -1;
+    if (path == NULL)
+        return;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path '%s' is too long\n", path);
+        exit(1);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    // never unlink anything but a socket
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path);
+
+    metrics->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (metrics->fd < 0 || bind(metrics->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(metrics->fd, METRICS_BACKLOG) < 0) {
+        fprintf(stderr, "Cannot listen on '%s': %s\n", path, strerror(errno));
+        exit(1);
+    }
+
+    if ((metrics->pollFd = epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+        epoll_ctl(metrics->pollFd, EPOLL_CTL_ADD, metrics->fd, &event) < 0) {
+        fprintf(stderr, "Cannot create epoll set: %s\n", strerror(errno));
+        exit(1);
+    }
+
+    metrics->path = path;
+    metricsRender(metrics, NULL);
+}
+
+
+/* ========================================================================
+ = METRICS_UPDATE
+ =
+ = Remember the newest sample of its kind
+ ======================================================================= */
+
+void metricsUpdate(metrics_t *metrics, const sample_t *sample) {
+    if (metrics->fd < 0)
+        return;
+
+    memcpy(&metrics->latest[sample->task], sample, sizeof(sample_t));
+    metrics->have[sample->task] = 1;
+}
+
+
+/* ========================================================================
+ = METRICS_PRINTF
+ =
+ = Append to the body, output that does not fit is cut off
+ ======================================================================= */
+
+static void metricsPrintf(metrics_t *metrics, const char *format, ...) {
+    size_t room = METRICS_BUF_SIZE - METRICS_HEADER_SIZE - metrics->len;
+    va_list args;
+    int len;
+
+    va_start(args, format);
+    len = vsnprintf(metrics->buf + METRICS_HEADER_SIZE + metrics->len, room, format, args);
+    va_end(args);
+
+    if (len > 0)
+        metrics->len += MIN((size_t)len, room - 1);
+}
+
+
+/* ========================================================================
+ = METRICS_FAMILY
+ =
+ = Append HELP and TYPE lines of a metric
+ ======================================================================= */
+
+static void metricsFamily(metrics_t *metrics, const char *name, const char *type, const char *help) {
+    metricsPrintf(metrics, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+
+/* ========================================================================
+ = METRICS_RENDER
+ =
+ = Format everything known into a complete HTTP response, so a scrape is
+ = nothing but a write of a ready buffer
+ ======================================================================= */
+
+void metricsRender(metrics_t *metrics, const ring_t *ring) {
+    char header[METRICS_HEADER_SIZE];
+    long hz = sysconf(_SC_CLK_TCK);
+    int len;
+
+    if (metrics->fd < 0)
+        return;
+
+    metrics->len = 0;
+
+    if (metrics->have[TASK_CPU]) {
+        const proc_stat_t *f = &metrics->latest[TASK_CPU].cpu.fields;
+        unsigned long long ticks[] = {
+            f->user, f->nice, f->sys, f->idle, f->iowait, f->irq, f->softirq, f->steal
+        };
+
+        metricsFamily(metrics, "sysmon_cpu_seconds_total", "counter", "Host CPU time by mode.");
+        for (int i = 0; i < 8; i++)
+            metricsPrintf(metrics, "sysmon_cpu_seconds_total{mode=\"%s\"} %.2f\n",
+                cpuModes[i], (double)ticks[i] / hz);
+
+        metricsFamily(metrics, "sysmon_cpu_busy_percent", "gauge", "CPU meter value.");
+        metricsPrintf(metrics, "sysmon_cpu_busy_percent %d\n", metrics->latest[TASK_CPU].cpu.total);
+        metricsFamily(metrics, "sysmon_context_switches_total", "counter", "Context switches.");
+        metricsPrintf(metrics, "sysmon_context_switches_total %llu\n", f->ctxt);
+        metricsFamily(metrics, "sysmon_forks_total", "counter", "Processes created.");
+        metricsPrintf(metrics, "sysmon_forks_total %llu\n", f->processes);
+        metricsFamily(metrics, "sysmon_procs_running", "gauge", "Runnable tasks.");
+        metricsPrintf(metrics, "sysmon_procs_running %ld\n", f->running);
+        metricsFamily(metrics, "sysmon_procs_blocked", "gauge", "Tasks blocked on IO.");
+        metricsPrintf(metrics, "sysmon_procs_blocked %ld\n", f->blocked);
+    }
+
+    if (metrics->have[TASK_MEM]) {
+        const sample_t *s = &metrics->latest[TASK_MEM];
+
+        metricsFamily(metrics, "sysmon_memory_total_bytes", "gauge", "Memory limit, the cgroup limit in cgroup mode.");
+        metricsPrintf(metrics, "sysmon_memory_total_bytes %lld\n", s->mem.total);
+        metricsFamily(metrics, "sysmon_memory_used_bytes", "gauge", "Memory in use as shown by the meter.");
+        metricsPrintf(metrics, "sysmon_memory_used_bytes %lld\n", s->mem.used);
+        metricsFamily(metrics, "sysmon_memory_available_bytes", "gauge", "Memory left before the limit.");
+        metricsPrintf(metrics, "sysmon_memory_available_bytes %lld\n", s->mem.available);
+        metricsFamily(metrics, "sysmon_swap_total_bytes", "gauge", "Host swap size.");
+        metricsPrintf(metrics, "sysmon_swap_total_bytes %lld\n", s->mem.swapTotal);
+        metricsFamily(metrics, "sysmon_swap_free_bytes", "gauge", "Host swap unused.");
+        metricsPrintf(metrics, "sysmon_swap_free_bytes %lld\n", s->mem.swapFree);
+    }
+
+    if (metrics->have[TASK_IO]) {
+        const sample_t *s = &metrics->latest[TASK_IO];
+
+        if (s->io.bytes) {
+            metricsFamily(metrics, "sysmon_cgroup_io_bytes_total", "counter", "Bytes read and written by the cgroup.");
+            metricsPrintf(metrics, "sysmon_cgroup_io_bytes_total %lld\n", s->io.counter);
+        } else {
+            metricsFamily(metrics, "sysmon_disk_io_weighted_seconds_total", "counter", "Weighted time spent doing IO by monitored disks.");
+            metricsPrintf(metrics, "sysmon_disk_io_weighted_seconds_total %.3f\n", s->io.counter / 1000.0);
+        }
+    }
+
+    if (metrics->have[TASK_NET]) {
+        const sample_t *s = &metrics->latest[TASK_NET];
+
+        metricsFamily(metrics, "sysmon_network_receive_bytes_total", "counter", "Bytes received by monitored interfaces.");
+        metricsPrintf(metrics, "sysmon_network_receive_bytes_total %llu\n", s->net.rx);
+        metricsFamily(metrics, "sysmon_network_transmit_bytes_total", "counter", "Bytes sent by monitored interfaces.");
+        metricsPrintf(metrics, "sysmon_network_transmit_bytes_total %llu\n", s->net.tx);
+    }
+
+    if (metrics->have[TASK_LOADAVG]) {
+        const float *load = metrics->latest[TASK_LOADAVG].loadavg;
+
+        metricsFamily(metrics, "sysmon_load1", "gauge", "1 minute load average.");
+        metricsPrintf(metrics, "sysmon_load1 %.2f\n", load[0]);
+        metricsFamily(metrics, "sysmon_load5", "gauge", "5 minute load average.");
+        metricsPrintf(metrics, "sysmon_load5 %.2f\n", load[1]);
+        metricsFamily(metrics, "sysmon_load15", "gauge", "15 minute load average.");
+        metricsPrintf(metrics, "sysmon_load15 %.2f\n", load[2]);
+    }
+
+    if (metrics->have[TASK_PSI]) {
+        const sample_t *s = &metrics->latest[TASK_PSI];
+
+        metricsFamily(metrics, "sysmon_pressure_some_avg10", "gauge", "Share of the last 10 s some task stalled on a resource.");
+        for (int i = 0; i < PSI_COUNT; i++)
+            if (s->pressure.avg10[i] >= 0)
+                metricsPrintf(metrics, "sysmon_pressure_some_avg10{resource=\"%s\"} %.2f\n",
+                    pressureResources[i], s->pressure.avg10[i] / 100.0);
+    }
+
+    if (ring != NULL) {
+        metricsFamily(metrics, "sysmon_samples_overwritten_total", "counter", "Samples lapped before the renderer read them.");
+        metricsPrintf(metrics, "sysmon_samples_overwritten_total %lu\n", ring->overwritten);
+        metricsFamily(metrics, "sysmon_samples_dropped_total", "counter", "Samples superseded before they were drawn.");
+        metricsPrintf(metrics, "sysmon_samples_dropped_total %lu\n", ring->dropped);
+    }
+
+    metricsFamily(metrics, "sysmon_scrapes_total", "counter", "Responses served up to the last sample.");
+    metricsPrintf(metrics, "sysmon_scrapes_total %lu\n", metrics->scrapes);
+
+    // put the header right in front of the body, both go out in one write
+    len = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\n"
+        "Content-Length: %zu\r\n\r\n", metrics->len);
+
+    metrics->response = metrics->buf + METRICS_HEADER_SIZE - len;
+    memcpy(metrics->response, header, len);
+    metrics->len += len;
+}
+
+
+/* ========================================================================
+ = METRICS_DROP
+ =
+ = Close a client once whatever it sent is read, closing a Unix socket
+ = with unread data resets it and the response would be lost
+ ======================================================================= */
+
+static void metricsDrop(metrics_t *metrics, metrics_client_t *client) {
+    char discard[1024];
+
+    while (recv(client->fd, discard, sizeof(discard), MSG_DONTWAIT) > 0);
+
+    epoll_ctl(metrics->pollFd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    client->fd = -1;
+}
+
+
+/* ========================================================================
+ = METRICS_SERVE
+ =
+ = Answer new connections with the pre-rendered response right away, the
+ = request is never parsed. Clients stay in the epoll set until their
+ = request arrives and is drained. Nothing here ever waits on a client.
+ ======================================================================= */
+
+void metricsServe(metrics_t *metrics, long long now) {
+    struct epoll_event events[METRICS_CLIENTS + 1];
+    int count, fd;
+
+    if ((count = epoll_wait(metrics->pollFd, events, METRICS_CLIENTS + 1, 0)) < 0)
+        return;
+
+    for (int i = 0; i < count; i++)
+        if (events[i].data.u32 < METRICS_CLIENTS)
+            metricsDrop(metrics, &metrics->clients[events[i].data.u32]);
+
+    for (int i = 0; i < METRICS_CLIENTS; i++)
+        if (metrics->clients[i].fd >= 0 && now - metrics->clients[i].since >= METRICS_LINGER_MS)
+            metricsDrop(metrics, &metrics->clients[i]);
+
+    // a burst of connections is spread over wakeups, the backlog holds them
+    for (int accepted = 0; accepted < METRICS_ACCEPTS; accepted++) {
+        struct epoll_event event = { .events = EPOLLIN | EPOLLRDHUP };
+        metrics_client_t *client = NULL;
+
+        if ((fd = accept4(metrics->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) < 0)
+            break;
+
+        // the response is far below the socket buffer, sending never waits
+        if (send(fd, metrics->response, metrics->len, MSG_NOSIGNAL) > 0)
+            metrics->scrapes++;
+        shutdown(fd, SHUT_WR);
+
+        // no free slot, the oldest client has had the longest to send
+        for (int j = 0; j < METRICS_CLIENTS; j++) {
+            if (metrics->clients[j].fd < 0) {
+                client = &metrics->clients[j];
+                break;
+            }
+            if (client == NULL || metrics->clients[j].since < client->since)
+                client = &metrics->clients[j];
+        }
+        if (client->fd >= 0)
+            metricsDrop(metrics, client);
+
+        event.data.u32 = client - metrics->clients;
+        if (epoll_ctl(metrics->pollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            continue;
+        }
+        client->fd = fd;
+        client->since = now;
+    }
+}
+
+
+/* ========================================================================
+ = METRICS_CLOSE
+ ======================================================================= */
+
+void metricsClose(metrics_t *metrics) {
+    if (metrics->fd < 0)
+        return;
+
+    for (int i = 0; i < METRICS_CLIENTS; i++)
+        if (metrics->clients[i].fd >= 0)
+            metricsDrop(metrics, &metrics->clients[i]);
+
+    close(metrics->pollFd);
+    close(metrics->fd);
+    unlink(metrics->path);
+    metrics->fd = -1;
+    metrics->pollFd = -1;
+}
@@ -0,0 +1,58 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <stddef.h>
+
+#include "sysmon.h"
+#include "ring.h"
+
+#define METRICS_BUF_SIZE    16384
+#define METRICS_HEADER_SIZE 128   // room reserved in front of the body
+#define METRICS_BACKLOG     16
+#define METRICS_ACCEPTS     8     // connections taken per wakeup, the rest wait
+#define METRICS_CLIENTS     16    // answered, waiting for their request to drain
+#define METRICS_LINGER_MS   1000  // a client silent for this long is dropped
+
+typedef struct {
+    int fd;                       // -1 for a free slot
+    long long since;              // CLOCK_MONOTONIC ms it was answered
+} metrics_client_t;
+
+typedef struct {
+    int fd;                       // listening socket, -1 when disabled
+    int pollFd;                   // epoll set of it and the clients, what the renderer polls
+    metrics_client_t clients[METRICS_CLIENTS];
+    const char *path;
+    sample_t latest[TASK_COUNT];
+    int have[TASK_COUNT];
+    char buf[METRICS_BUF_SIZE];   // header and body of the next response
+    char *response;               // start of the header within buf
+    size_t len;                   // body length while rendering, response after
+    unsigned long scrapes;
+} metrics_t;
+
+void metricsOpen(metrics_t *metrics, const char *path);
+void metricsUpdate(metrics_t *metrics, const sample_t *sample);
+void metricsRender(metrics_t *metrics, const ring_t *ring);
+void metricsServe(metrics_t *metrics, long long now);
+void metricsClose(metrics_t *metrics);
+
+#endif // __METRICS_H__
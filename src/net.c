@@ -0,0 +1,392 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fnmatch.h>
+
+#include "sysmon.h"
+#include "net.h"
+
+#define NET_HEADER_LINES 2
+
+
+/* ========================================================================
+ = NEXT_ULL
+ =
+ = Skip spaces and parse a decimal field
+ ======================================================================= */
+
+static inline const char *nextUll(const char *p, unsigned long long *value) {
+    unsigned long long v = 0;
+
+    while (*p == ' ') p++;
+    for (; *p >= '0' && *p <= '9'; p++)
+        v = v*10 + (*p - '0');
+
+    *value = v;
+    return p;
+}
+
+
+/* ========================================================================
+ = LINE_NAME
+ =
+ = Locate the interface name of a line, returns the position after the
+ = colon or NULL if the line has none
+ ======================================================================= */
+
+static const char *lineName(const char *p, const char *end, const char **name, size_t *len) {
+    const char *colon;
+
+    while (p < end && *p == ' ') p++;
+    if ((colon = memchr(p, ':', MIN(end - p, NET_NAME_LEN))) == NULL)
+        return NULL;
+
+    *name = p;
+    *len = colon - p;
+    return colon + 1;
+}
+
+
+/* ========================================================================
+ = LINE_BYTES
+ =
+ = Add received and transmitted bytes, the 1st and 9th field
+ ======================================================================= */
+
+static const char *lineBytes(const char *p, net_bytes_t *bytes) {
+    unsigned long long value;
+
+    p = nextUll(p, &value);
+    bytes->rx += value;
+
+    for (int i = 0; i < 7; i++)
+        p = nextUll(p, &value);
+
+    p = nextUll(p, &value);
+    bytes->tx += value;
+
+    return p;
+}
+
+
+/* ========================================================================
+ = NAME_HASH
+ =
+ = FNV-1a of an interface name
+ ======================================================================= */
+
+static inline unsigned int nameHash(const char *name, size_t len) {
+    unsigned int hash = 2166136261U;
+
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ (unsigned char)name[i]) * 16777619U;
+
+    return hash;
+}
+
+
+/* ========================================================================
+ = NET_MATCHES
+ =
+ = Test an interface against the filter: no exclude may match, and some
+ = include has to unless there are none
+ ======================================================================= */
+
+static int netMatches(net_table_t *net, const char *name) {
+    int includes = 0, included = 0;
+
+    for (int i = 0; i < net->patternCount; i++) {
+        const char *pattern = net->patterns[i];
+
+        if (*pattern == '!') {
+            if (fnmatch(pattern + 1, name, 0) == 0)
+                return 0;
+        } else {
+            includes++;
+            included |= fnmatch(pattern, name, 0) == 0;
+        }
+    }
+
+    return includes == 0 || included;
+}
+
+
+/* ========================================================================
+ = NET_SLOT
+ =
+ = Find an interface in the open addressing table. When absent, returns
+ = -(free slot) - 1 so the caller can insert without probing again
+ ======================================================================= */
+
+static long netSlot(net_entry_t *table, size_t size, const char *name, size_t len, unsigned int hash) {
+    size_t slot = hash & (size - 1);
+
+    while (table[slot].used) {
+        if (table[slot].hash == hash && !strncmp(table[slot].name, name, len) && table[slot].name[len] == '\0')
+            return slot;
+        slot = (slot + 1) & (size - 1);
+    }
+
+    return -(long)slot - 1;
+}
+
+
+/* ========================================================================
+ = NET_GROW
+ =
+ = Double the table and remap the monitored list to the new slots
+ ======================================================================= */
+
+static void netGrow(net_table_t *net) {
+    size_t size = net->size * 2;
+    net_entry_t *table;
+
+    if ((table = calloc(size, sizeof(net_entry_t))) == NULL) {
+        fprintf(stderr, "Cannot allocate interface table\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < net->size; i++) {
+        net_entry_t *entry = &net->table[i];
+
+        if (entry->used)
+            table[-netSlot(table, size, entry->name, strlen(entry->name), entry->hash) - 1] = *entry;
+    }
+
+    for (int i = 0; i < net->monitoredCount; i++) {
+        net_entry_t *entry = &net->table[net->monitored[i]];
+        net->monitored[i] = netSlot(table, size, entry->name, strlen(entry->name), entry->hash);
+    }
+
+    free(net->table);
+    net->table = table;
+    net->size = size;
+}
+
+
+/* ========================================================================
+ = NET_MONITOR
+ =
+ = Append a table slot to the monitored list
+ ======================================================================= */
+
+static void netMonitor(net_table_t *net, long slot) {
+    if (net->monitoredCount == net->monitoredSize) {
+        net->monitoredSize = MAX(16, net->monitoredSize * 2);
+        net->monitored = realloc(net->monitored, net->monitoredSize * sizeof(int));
+        if (net->monitored == NULL) {
+            fprintf(stderr, "Cannot allocate interface table\n");
+            exit(1);
+        }
+    }
+
+    net->monitored[net->monitoredCount++] = slot;
+    net->monitoredSum += net->table[slot].hash;
+}
+
+
+/* ========================================================================
+ = NET_FULL_SCAN
+ =
+ = Walk every line, learning new interfaces and recording line offsets.
+ = Filter results are cached per name, so excluded interfaces cost a hash
+ = lookup instead of a pass over every pattern.
+ ======================================================================= */
+
+static void netFullScan(net_table_t *net, const char *buf, size_t len, net_bytes_t *bytes) {
+    const char *p = buf, *end = buf + len, *eol;
+
+    // forget interfaces that are long gone, pods come and go all the time
+    if (net->used > (size_t)net->lines * 2 + NET_TABLE_SIZE / 2) {
+        memset(net->table, 0, net->size * sizeof(net_entry_t));
+        net->used = 0;
+    }
+
+    net->monitoredCount = 0;
+    net->monitoredSum = 0;
+    net->lines = 0;
+    net->ticks = 0;
+
+    for (int i = 0; i < NET_HEADER_LINES && p < end; i++) {
+        if ((eol = memchr(p, '\n', end - p)) == NULL)
+            return;
+        p = eol + 1;
+    }
+
+    while (p < end) {
+        const char *line = p, *name;
+        unsigned int hash;
+        size_t nameLen;
+        long slot;
+
+        net->linesScanned++;
+        if ((p = lineName(p, end, &name, &nameLen)) == NULL)
+            break;
+
+        hash = nameHash(name, nameLen);
+        if ((slot = netSlot(net->table, net->size, name, nameLen, hash)) < 0) {
+            if ((net->used + 1) * 2 > net->size) {
+                netGrow(net);
+                slot = netSlot(net->table, net->size, name, nameLen, hash);
+            }
+
+            slot = -slot - 1;
+            net->table[slot].used = 1;
+            net->table[slot].hash = hash;
+            memcpy(net->table[slot].name, name, nameLen);
+            net->table[slot].name[nameLen] = '\0';
+            net->table[slot].monitored = netMatches(net, net->table[slot].name);
+            net->used++;
+        }
+
+        net->lines++;
+        net->table[slot].offset = line - buf;
+        if (net->table[slot].monitored) {
+            p = lineBytes(p, bytes);
+            netMonitor(net, slot);
+        }
+
+        if ((eol = memchr(p, '\n', end - p)) == NULL)
+            break;
+        p = eol + 1;
+    }
+}
+
+
+/* ========================================================================
+ = NET_RESCAN
+ =
+ = Full scan that notes whether interfaces joined or left the monitored set
+ ======================================================================= */
+
+static void netRescan(net_table_t *net, const char *buf, size_t len, net_bytes_t *bytes) {
+    int count = net->monitoredCount;
+    unsigned int sum = net->monitoredSum;
+
+    netFullScan(net, buf, len, bytes);
+    if (net->monitoredCount != count || net->monitoredSum != sum)
+        net->generation++;
+}
+
+
+/* ========================================================================
+ = NET_INIT
+ =
+ = Set up an empty table, filter is a comma separated list of globs
+ ======================================================================= */
+
+void netInit(net_table_t *net, const char *filter) {
+    char *pattern, *save;
+
+    memset(net, 0, sizeof(net_table_t));
+
+    net->filter = strdup(filter ? filter : NET_DEFAULT_FILTER);
+    net->patterns = malloc((strlen(net->filter) / 2 + 1) * sizeof(char *));
+    net->size = NET_TABLE_SIZE;
+    net->table = calloc(net->size, sizeof(net_entry_t));
+
+    if (net->filter == NULL || net->patterns == NULL || net->table == NULL) {
+        fprintf(stderr, "Cannot allocate interface table\n");
+        exit(1);
+    }
+
+    pattern = strtok_r(net->filter, ",", &save);
+    for (; pattern != NULL; pattern = strtok_r(NULL, ",", &save))
+        net->patterns[net->patternCount++] = pattern;
+}
+
+
+/* ========================================================================
+ = NET_BYTES
+ =
+ = Sum bytes received and sent by monitored interfaces. Between full scans
+ = only the remembered line offsets are visited, every other line is
+ = skipped without being looked at.
+ ======================================================================= */
+
+void netBytes(net_table_t *net, const char *buf, size_t len, net_bytes_t *bytes) {
+    const char *end = buf + len;
+    size_t from = 0;
+    long shift = 0;
+
+    bytes->rx = bytes->tx = 0;
+
+    if (net->used == 0 || ++net->ticks >= NET_RESCAN_TICKS) {
+        netRescan(net, buf, len, bytes);
+        return;
+    }
+
+    for (int i = 0; i < net->monitoredCount; i++) {
+        net_entry_t *entry = &net->table[net->monitored[i]];
+        size_t pos = entry->offset + shift, nameLen;
+        const char *p = NULL, *name, *eol;
+
+        if (pos > 0 && pos < len && buf[pos-1] == '\n') {
+            p = lineName(buf + pos, end, &name, &nameLen);
+            if (p != NULL && (strncmp(entry->name, name, nameLen) || entry->name[nameLen] != '\0'))
+                p = NULL;
+        }
+
+        // line moved, look for it between the previous interface and the end
+        for (const char *q = buf + from; p == NULL && q < end; ) {
+            const char *next = lineName(q, end, &name, &nameLen);
+
+            net->linesScanned++;
+            if (next != NULL && !strncmp(entry->name, name, nameLen) && entry->name[nameLen] == '\0') {
+                pos = q - buf;
+                shift = (long)pos - (long)entry->offset;
+                p = next;
+                break;
+            }
+
+            if ((q = memchr(q, '\n', end - q)) == NULL)
+                break;
+            q++;
+        }
+
+        // interface went away
+        if (p == NULL) {
+            bytes->rx = bytes->tx = 0;
+            netRescan(net, buf, len, bytes);
+            return;
+        }
+
+        entry->offset = pos;
+        p = lineBytes(p, bytes);
+
+        if ((eol = memchr(p, '\n', end - p)) == NULL)
+            break;
+        from = eol + 1 - buf;
+    }
+}
+
+
+/* ========================================================================
+ = NET_FREE
+ ======================================================================= */
+
+void netFree(net_table_t *net) {
+    free(net->table);
+    free(net->monitored);
+    free(net->patterns);
+    free(net->filter);
+    memset(net, 0, sizeof(net_table_t));
+}
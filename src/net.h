@@ -0,0 +1,69 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __NET_H__
+#define __NET_H__
+
+#include <stddef.h>
+
+#define NET_TABLE_SIZE   256 // initial slots, grows by doubling
+#define NET_RESCAN_TICKS 40  // full scan interval to pick up new interfaces
+#define NET_NAME_LEN     16  // IFNAMSIZ
+#define NET_MAX_DECAY    240 // base ticks for the meter scale to forget a peak
+
+// globs, a leading ! excludes; loopback and container plumbing would
+// count every packet twice
+#define NET_DEFAULT_FILTER \
+    "!lo,!veth*,!cali*,!cilium*,!lxc*,!docker*,!br-*,!virbr*,!cni*," \
+    "!flannel*,!vxlan*,!tunl*,!kube-*"
+
+typedef struct {
+    char name[NET_NAME_LEN];
+    unsigned int hash;
+    int used;
+    int monitored;
+    size_t offset; // start of the interface line in the last read
+} net_entry_t;
+
+typedef struct {
+    net_entry_t *table;
+    size_t size;
+    size_t used;
+    int *monitored; // table slots of monitored interfaces, in file order
+    int monitoredCount;
+    int monitoredSize;
+    unsigned int monitoredSum; // name hashes of monitored interfaces added up
+    unsigned long generation;  // bumped when a full scan changes the monitored set
+    char *filter;
+    char **patterns;
+    int patternCount;
+    int ticks;
+    int lines;      // interfaces seen by the last full scan
+    unsigned long linesScanned;
+} net_table_t;
+
+typedef struct {
+    unsigned long long rx;
+    unsigned long long tx;
+} net_bytes_t;
+
+void netInit(net_table_t *net, const char *filter);
+void netBytes(net_table_t *net, const char *buf, size_t len, net_bytes_t *bytes);
+void netFree(net_table_t *net);
+
+#endif // __NET_H__
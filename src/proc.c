@@ -0,0 +1,223 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "proc.h"
+
+proc_syscalls_t procSyscalls;
+
+
+/* ========================================================================
+ = PROC_PATH
+ =
+ = Prefix an absolute path with $SYSMON_PROC_ROOT, so a fixture tree
+ = captured elsewhere can stand in for /proc and /sys. Returns a newly
+ = allocated string.
+ ======================================================================= */
+
+char *procPath(const char *path) {
+    const char *root = getenv(PROC_ROOT_ENV);
+    char *rooted;
+
+    if (root == NULL)
+        root = "";
+
+    if ((rooted = malloc(strlen(root) + strlen(path) + 1)) == NULL) {
+        fprintf(stderr, "Cannot allocate path for '%s'\n", path);
+        exit(1);
+    }
+
+    sprintf(rooted, "%s%s", root, path);
+    return rooted;
+}
+
+
+/* ========================================================================
+ = PROC_REOPEN
+ =
+ = (Re)open the underlying file descriptor, returns -1 on failure
+ ======================================================================= */
+
+static int procReopen(proc_file_t *file) {
+    if (file->fd >= 0) {
+        close(file->fd);
+        procSyscalls.closes++;
+    }
+
+    file->fd = open(file->path, file->flags | O_CLOEXEC);
+    procSyscalls.opens++;
+
+    return file->fd;
+}
+
+
+/* ========================================================================
+ = PROC_TRY_OPEN
+ =
+ = Open a /proc file once and allocate its read buffer, returns -1 if the
+ = file cannot be opened
+ ======================================================================= */
+
+int procTryOpen(proc_file_t *file, const char *path, int flags) {
+    memset(file, 0, sizeof(proc_file_t));
+    file->path = procPath(path);
+    file->flags = flags;
+    file->fd = -1;
+
+    if (procReopen(file) < 0) {
+        free(file->path);
+        file->path = NULL;
+        return -1;
+    }
+
+    file->size = PROC_BUF_SIZE;
+    if ((file->buf = malloc(file->size)) == NULL) {
+        fprintf(stderr, "Cannot allocate buffer for '%s'\n", path);
+        exit(1);
+    }
+    file->buf[0] = '\0';
+
+    return 0;
+}
+
+
+/* ========================================================================
+ = PROC_OPEN
+ =
+ = Open a /proc file for reading, the file is required to exist
+ ======================================================================= */
+
+void procOpen(proc_file_t *file, const char *path) {
+    if (procTryOpen(file, path, O_RDONLY) < 0) {
+        int error = errno;
+        char *rooted = procPath(path);
+
+        fprintf(stderr, "Cannot open '%s' for reading: %s\n", rooted, strerror(error));
+        exit(1);
+    }
+}
+
+
+/* ========================================================================
+ = PROC_TRY_READ
+ =
+ = Re-read file contents from offset zero, returns NUL terminated buffer
+ = or NULL when the file could not be read even after reopening it
+ ======================================================================= */
+
+char *procTryRead(proc_file_t *file) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (attempt > 0 && procReopen(file) < 0)
+            break;
+
+        file->len = 0;
+        while (1) {
+            size_t want = file->size - file->len - 1;
+            ssize_t got = pread(file->fd, file->buf + file->len, want, file->len);
+            procSyscalls.reads++;
+
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+
+            file->len += got;
+
+            // seq_file fills the whole request unless it hit EOF
+            if ((size_t)got < want) {
+                file->buf[file->len] = '\0';
+                return file->buf;
+            }
+
+            // file outgrew the buffer, only happens until it settles
+            file->size *= 2;
+            if ((file->buf = realloc(file->buf, file->size)) == NULL) {
+                fprintf(stderr, "Cannot allocate buffer for '%s'\n", file->path);
+                exit(1);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+
+/* ========================================================================
+ = PROC_READ
+ =
+ = Re-read a required file, exits if it cannot be read
+ ======================================================================= */
+
+char *procRead(proc_file_t *file) {
+    char *buf;
+
+    if ((buf = procTryRead(file)) == NULL) {
+        fprintf(stderr, "Cannot read '%s': %s\n", file->path, strerror(errno));
+        exit(1);
+    }
+
+    return buf;
+}
+
+
+/* ========================================================================
+ = PROC_CLOSE
+ =
+ = Release file descriptor and buffer
+ ======================================================================= */
+
+void procClose(proc_file_t *file) {
+    if (file->fd >= 0) {
+        close(file->fd);
+        procSyscalls.closes++;
+    }
+
+    free(file->buf);
+    free(file->path);
+    file->fd = -1;
+    file->buf = NULL;
+    file->path = NULL;
+    file->size = file->len = 0;
+}
+
+
+/* ========================================================================
+ = PARSE_LOAD_AVG
+ =
+ = Decode the 1, 5 and 15 minute averages of /proc/loadavg, returns -1
+ = if any is missing
+ ======================================================================= */
+
+int parseLoadAvg(const char *buf, float *load) {
+    char *end;
+
+    for (int i = 0; i < 3; i++) {
+        load[i] = strtof(buf, &end);
+        if (end == buf)
+            return -1;
+        buf = end;
+    }
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __PROC_H__
+#define __PROC_H__
+
+#include <stddef.h>
+
+#define PROC_BUF_SIZE 4096
+#define PROC_ROOT_ENV "SYSMON_PROC_ROOT" // replays a captured tree instead of /
+
+// a /proc file held open between ticks and re-read from offset zero
+typedef struct {
+    char *path;           // with the proc root applied
+    int fd;
+    int flags;
+    char *buf;
+    size_t size;
+    size_t len;
+} proc_file_t;
+
+typedef struct {
+    unsigned long opens;
+    unsigned long reads;
+    unsigned long closes;
+} proc_syscalls_t;
+
+extern proc_syscalls_t procSyscalls;
+
+char *procPath(const char *path);
+int parseLoadAvg(const char *buf, float *load);
+int procTryOpen(proc_file_t *file, const char *path, int flags);
+void procOpen(proc_file_t *file, const char *path);
+char *procTryRead(proc_file_t *file);
+char *procRead(proc_file_t *file);
+void procClose(proc_file_t *file);
+
+#endif // __PROC_H__
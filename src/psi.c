@@ -0,0 +1,181 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "psi.h"
+
+
+/* ========================================================================
+ = PSI_READ
+ =
+ = Refresh avg10 of the "some" line, returns -1 if unreadable
+ ======================================================================= */
+
+static int psiRead(psi_source_t *source, long long now) {
+    char *buf, *avg;
+
+    source->lastRead = now;
+    if ((buf = procTryRead(&source->file)) == NULL)
+        return -1;
+
+    if ((avg = strstr(buf, "avg10=")) == NULL)
+        return -1;
+
+    source->avg10 = strtof(avg + 6, NULL);
+    return 0;
+}
+
+
+/* ========================================================================
+ = PSI_TRIGGER
+ =
+ = Open a pressure file and register a stall trigger on it
+ ======================================================================= */
+
+static int psiTrigger(psi_source_t *source, const char *path, const char *trigger) {
+    if (procTryOpen(&source->file, path, O_RDWR | O_NONBLOCK) < 0)
+        return -1;
+
+    // the kernel wants the terminating NUL as part of the write
+    if (write(source->file.fd, trigger, strlen(trigger) + 1) < 0) {
+        procClose(&source->file);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* ========================================================================
+ = PSI_INIT
+ =
+ = Set up trigger fds where permitted, plain periodic reads otherwise
+ ======================================================================= */
+
+void psiInit(psi_t *psi, const char **paths) {
+    // a trigger write would end up in the files of a replayed tree
+    int replay = getenv(PROC_ROOT_ENV) != NULL;
+
+    memset(psi, 0, sizeof(psi_t));
+
+    for (int i = 0; i < PSI_COUNT; i++) {
+        psi_source_t *source = &psi->source[i];
+
+        source->lastEvent = -PSI_HOLD_MS;
+
+        if (!replay && (psiTrigger(source, paths[i], PSI_TRIGGER) == 0 ||
+            psiTrigger(source, paths[i], PSI_TRIGGER_UNPRIV) == 0)) {
+            source->triggered = 1;
+        }
+        else if (procTryOpen(&source->file, paths[i], O_RDONLY) < 0) {
+            continue;
+        }
+
+        // kernels booted with psi=0 have the files but fail reads
+        if (psiRead(source, 0) < 0) {
+            procClose(&source->file);
+            source->triggered = 0;
+            continue;
+        }
+
+        source->available = 1;
+    }
+}
+
+
+/* ========================================================================
+ = PSI_POLL_FDS
+ =
+ = Fill pollfds for sources with triggers, returns number of entries
+ ======================================================================= */
+
+int psiPollFds(psi_t *psi, struct pollfd *fds, int *sources, int max) {
+    int count = 0;
+
+    for (int i = 0; i < PSI_COUNT && count < max; i++) {
+        if (!psi->source[i].triggered)
+            continue;
+
+        fds[count].fd = psi->source[i].file.fd;
+        fds[count].events = POLLPRI;
+        fds[count].revents = 0;
+        sources[count++] = i;
+    }
+
+    return count;
+}
+
+
+/* ========================================================================
+ = PSI_EVENT
+ =
+ = Handle poll result for a trigger fd
+ ======================================================================= */
+
+void psiEvent(psi_t *psi, int index, short revents, long long now) {
+    psi_source_t *source = &psi->source[index];
+
+    // trigger is gone, keep going with periodic reads
+    if (revents & (POLLERR | POLLNVAL)) {
+        source->triggered = 0;
+        return;
+    }
+
+    if (revents & POLLPRI) {
+        source->lastEvent = now;
+        psiRead(source, now);
+    }
+}
+
+
+/* ========================================================================
+ = PSI_UPDATE
+ =
+ = Periodic avg10 refresh, also detects stalls when triggers are missing.
+ = Meant to be called every PSI_INTERVAL.
+ ======================================================================= */
+
+void psiUpdate(psi_t *psi, long long now) {
+    for (int i = 0; i < PSI_COUNT; i++) {
+        psi_source_t *source = &psi->source[i];
+
+        if (!source->available)
+            continue;
+
+        if (psiRead(source, now) == 0 && !source->triggered && source->avg10 >= PSI_THRESHOLD)
+            source->lastEvent = now;
+    }
+}
+
+
+/* ========================================================================
+ = PSI_STALL_END
+ =
+ = Until when a resource counts as stalled, 0 if pressure is unavailable
+ ======================================================================= */
+
+long long psiStallEnd(const psi_t *psi, int index) {
+    const psi_source_t *source = &psi->source[index];
+
+    return source->available ? source->lastEvent + PSI_HOLD_MS : 0;
+}
@@ -0,0 +1,59 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __PSI_H__
+#define __PSI_H__
+
+#include <poll.h>
+
+#include "proc.h"
+
+// 150 ms of stall within 1 s, unprivileged triggers need 2 s windows
+#define PSI_TRIGGER        "some 150000 1000000"
+#define PSI_TRIGGER_UNPRIV "some 300000 2000000"
+#define PSI_THRESHOLD      15.0F // avg10 percent equivalent of the trigger
+#define PSI_HOLD_MS        2000  // keep a stall visible after the last event
+#define PSI_INTERVAL       2000  // avg10 refresh, also the fallback poll rate
+
+enum {
+    PSI_CPU,
+    PSI_MEM,
+    PSI_IO,
+    PSI_COUNT
+};
+
+typedef struct {
+    proc_file_t file;
+    int available;
+    int triggered; // kernel trigger registered, fd raises POLLPRI
+    float avg10;
+    long long lastEvent;
+    long long lastRead;
+} psi_source_t;
+
+typedef struct {
+    psi_source_t source[PSI_COUNT];
+} psi_t;
+
+void psiInit(psi_t *psi, const char **paths);
+int psiPollFds(psi_t *psi, struct pollfd *fds, int *sources, int max);
+void psiEvent(psi_t *psi, int index, short revents, long long now);
+void psiUpdate(psi_t *psi, long long now);
+long long psiStallEnd(const psi_t *psi, int index);
+
+#endif // __PSI_H__
@@ -0,0 +1,98 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "ring.h"
+
+
+/* ========================================================================
+ = RING_INIT
+ =
+ = Empty the ring, no slot holds a published sample yet
+ ======================================================================= */
+
+void ringInit(ring_t *ring) {
+    memset(ring, 0, sizeof(ring_t));
+
+    for (int i = 0; i < RING_SIZE; i++)
+        atomic_init(&ring->slots[i].seq, 0);
+    atomic_init(&ring->head, 0);
+}
+
+
+/* ========================================================================
+ = RING_PUSH
+ =
+ = Publish a sample, overwrites the oldest one when the ring is full
+ ======================================================================= */
+
+void ringPush(ring_t *ring, const sample_t *sample) {
+    unsigned long n = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    ring_slot_t *slot = &ring->slots[n & (RING_SIZE - 1)];
+
+    // odd sequence tells a concurrent reader the slot is being rewritten
+    atomic_store_explicit(&slot->seq, 2*n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    memcpy(&slot->sample, sample, sizeof(sample_t));
+
+    atomic_store_explicit(&slot->seq, 2*n + 2, memory_order_release);
+    atomic_store_explicit(&ring->head, n + 1, memory_order_release);
+}
+
+
+/* ========================================================================
+ = RING_POP
+ =
+ = Copy out the oldest unread sample, returns 0 when there is none. Samples
+ = the producer overwrote before we got to them are skipped and counted.
+ ======================================================================= */
+
+int ringPop(ring_t *ring, sample_t *sample) {
+    unsigned long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    while (ring->tail != head) {
+        ring_slot_t *slot = &ring->slots[ring->tail & (RING_SIZE - 1)];
+        unsigned long expect = 2*ring->tail + 2, seq;
+
+        // lapped, everything older than one ring behind head is gone
+        if (head - ring->tail > RING_SIZE) {
+            ring->overwritten += head - ring->tail - RING_SIZE;
+            ring->tail = head - RING_SIZE;
+            continue;
+        }
+
+        seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq == expect) {
+            memcpy(sample, &slot->sample, sizeof(sample_t));
+            atomic_thread_fence(memory_order_acquire);
+            seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+        }
+
+        ring->tail++;
+        if (seq == expect)
+            return 1;
+
+        // rewritten while we looked at it
+        ring->overwritten++;
+        head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    }
+
+    return 0;
+}
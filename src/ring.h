@@ -0,0 +1,47 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __RING_H__
+#define __RING_H__
+
+#include <stdatomic.h>
+
+#include "sysmon.h"
+
+#define RING_SIZE 64 // power of two, 4-5 s at the 3-4 samples of a typical base tick
+
+typedef struct {
+    atomic_ulong seq; // 2n+1 while sample n is written, 2n+2 once published
+    sample_t sample;
+} ring_slot_t;
+
+// single producer, single consumer, the producer never waits and laps
+// a consumer that falls behind
+typedef struct {
+    ring_slot_t slots[RING_SIZE];
+    atomic_ulong head;         // samples published so far
+    unsigned long tail;        // consumer only
+    unsigned long overwritten; // consumer only, lapped before they were read
+    unsigned long dropped;     // consumer only, read but never shown
+} ring_t;
+
+void ringInit(ring_t *ring);
+void ringPush(ring_t *ring, const sample_t *sample);
+int ringPop(ring_t *ring, sample_t *sample);
+
+#endif // __RING_H__
@@ -0,0 +1,147 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <X11/extensions/dpms.h>
+#include <X11/extensions/scrnsaver.h>
+
+#include "sysmon.h"
+#include "saver.h"
+
+
+/* ========================================================================
+ = SAVER_INIT
+ =
+ = Assume the screen is on until told otherwise
+ ======================================================================= */
+
+void saverInit(saver_t *saver, Display *display, int poll, long long now) {
+    memset(saver, 0, sizeof(saver_t));
+    saver->display = display;
+    saver->poll = poll;
+    saver->saverEvent = -1;
+    saver->nextPoll = now + SAVER_POLL_MS;
+}
+
+
+/* ========================================================================
+ = SAVER_CHECK
+ =
+ = Look up both extensions once, subscribe to screensaver notifications
+ = and read where they stand now
+ ======================================================================= */
+
+static void saverCheck(saver_t *saver) {
+    Window root = DefaultRootWindow(saver->display);
+    XScreenSaverInfo info;
+    int event, error;
+
+    saver->checked = 1;
+
+    if (XScreenSaverQueryExtension(saver->display, &event, &error)) {
+        saver->saverEvent = event + ScreenSaverNotify;
+        XScreenSaverSelectInput(saver->display, root, ScreenSaverNotifyMask | ScreenSaverCycleMask);
+        if (XScreenSaverQueryInfo(saver->display, root, &info))
+            saver->saverOn = info.state == ScreenSaverOn;
+    }
+
+    saver->dpms = saver->poll && DPMSQueryExtension(saver->display, &event, &error) &&
+        DPMSCapable(saver->display);
+}
+
+
+/* ========================================================================
+ = SAVER_EVENT
+ =
+ = Follow the screensaver, returns 1 if the screen went blank or came back
+ ======================================================================= */
+
+int saverEvent(saver_t *saver, const XEvent *event) {
+    const XScreenSaverNotifyEvent *notify = (const XScreenSaverNotifyEvent *)event;
+    int on;
+
+    if (saver->saverEvent < 0 || event->type != saver->saverEvent)
+        return 0;
+
+    on = notify->state != ScreenSaverOff;
+    if (on == saver->saverOn)
+        return 0;
+
+    saver->saverOn = on;
+    return 1;
+}
+
+
+/* ========================================================================
+ = SAVER_POLL
+ =
+ = Ask for the DPMS level when it is time, returns 1 if the monitor was
+ = switched off or back on
+ ======================================================================= */
+
+int saverPoll(saver_t *saver, long long now) {
+    CARD16 level;
+    BOOL enabled;
+    int off;
+
+    if (now < saver->nextPoll)
+        return 0;
+    saver->nextPoll = now + SAVER_POLL_MS;
+
+    if (!saver->checked) {
+        saverCheck(saver);
+        return saverBlank(saver);
+    }
+
+    if (!saver->dpms || !DPMSInfo(saver->display, &level, &enabled))
+        return 0;
+
+    off = enabled && level != DPMSModeOn;
+    if (off == saver->dpmsOff)
+        return 0;
+
+    saver->dpmsOff = off;
+    return 1;
+}
+
+
+/* ========================================================================
+ = SAVER_TIMEOUT
+ =
+ = Milliseconds until saverPoll has something to do, -1 for never
+ ======================================================================= */
+
+int saverTimeout(const saver_t *saver, long long now) {
+    if (saver->checked && !saver->dpms)
+        return -1;
+
+    return (int)MAX(0, saver->nextPoll - now);
+}
+
+
+/* ========================================================================
+ = SAVER_BLANK
+ =
+ = Whether nothing drawn could be seen
+ ======================================================================= */
+
+int saverBlank(const saver_t *saver) {
+    return saver->saverOn || saver->dpmsOff;
+}
@@ -0,0 +1,48 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SAVER_H__
+#define __SAVER_H__
+
+#include <X11/Xlib.h>
+
+#define SAVER_POLL_MS 10000 // DPMS has no events, its state is asked this often
+
+/*
+ * Whether the screen shows anything at all. The screensaver reports its
+ * state with events, DPMS has to be polled. The extensions are looked up
+ * at the first poll rather than adding round trips to startup.
+ */
+typedef struct {
+    Display *display;
+    int poll;               // DPMS may be polled, off for remote displays
+    int checked;            // extensions looked up
+    int saverEvent;         // ScreenSaverNotify event type, -1 without it
+    int saverOn;
+    int dpms;               // DPMS capable
+    int dpmsOff;            // monitor in standby, suspend or off
+    long long nextPoll;
+} saver_t;
+
+void saverInit(saver_t *saver, Display *display, int poll, long long now);
+int saverEvent(saver_t *saver, const XEvent *event);
+int saverPoll(saver_t *saver, long long now);
+int saverTimeout(const saver_t *saver, long long now);
+int saverBlank(const saver_t *saver);
+
+#endif // __SAVER_H__
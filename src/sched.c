@@ -0,0 +1,234 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sysmon.h"
+#include "sched.h"
+
+
+/* ========================================================================
+ = NOW_MS
+ =
+ = Monotonic clock in milliseconds
+ ======================================================================= */
+
+long long nowMs(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+
+/* ========================================================================
+ = NOW_NS
+ =
+ = Monotonic clock in nanoseconds, for measuring our own cost
+ ======================================================================= */
+
+long long nowNs(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+/* ========================================================================
+ = SCHED_INIT
+ =
+ = Start every task at its base interval, all due right away
+ ======================================================================= */
+
+void schedInit(sched_t *sched, sched_task_t *tasks, int count, long long now) {
+    memset(sched, 0, sizeof(sched_t));
+    sched->tasks = tasks;
+    sched->count = count;
+    sched->windowStart = now;
+
+    for (int i = 0; i < count; i++) {
+        tasks[i].intervalMs = tasks[i].baseMs;
+        tasks[i].due = now;
+        tasks[i].value = -1;
+        tasks[i].runs = 0;
+    }
+}
+
+
+/* ========================================================================
+ = SCHED_CONFIGURE
+ =
+ = Apply "name=base[:max],..." intervals in milliseconds, returns -1 if
+ = the spec is malformed or names an unknown task
+ ======================================================================= */
+
+int schedConfigure(sched_t *sched, const char *spec) {
+    char *copy, *item, *save;
+    int result = 0;
+
+    if ((copy = strdup(spec)) == NULL)
+        return -1;
+
+    item = strtok_r(copy, ",", &save);
+    for (; item != NULL; item = strtok_r(NULL, ",", &save)) {
+        char *value = strchr(item, '='), *end;
+        sched_task_t *task = NULL;
+        long long base, max;
+
+        if (value == NULL) {
+            result = -1;
+            break;
+        }
+        *value++ = '\0';
+
+        for (int i = 0; i < sched->count; i++)
+            if (!strcmp(sched->tasks[i].name, item))
+                task = &sched->tasks[i];
+
+        if (task == NULL) {
+            result = -1;
+            break;
+        }
+
+        // without an explicit ceiling keep the task's backoff ratio
+        base = strtoll(value, &end, 10);
+        max = (*end == ':') ? strtoll(end + 1, &end, 10) : base * task->maxMs / MAX(1, task->baseMs);
+
+        if (*end != '\0' || base <= 0 || max < base) {
+            result = -1;
+            break;
+        }
+
+        task->baseMs = task->intervalMs = base;
+        task->maxMs = max;
+    }
+
+    free(copy);
+    return result;
+}
+
+
+/* ========================================================================
+ = SCHED_DUE
+ =
+ = Collect tasks due now or within the slack window, so one wakeup
+ = serves every deadline that falls close together
+ ======================================================================= */
+
+int schedDue(sched_t *sched, long long now, int *due) {
+    int count = 0;
+
+    for (int i = 0; i < sched->count; i++)
+        if (sched->tasks[i].due <= now + SCHED_SLACK_MS)
+            due[count++] = i;
+
+    return count;
+}
+
+
+/* ========================================================================
+ = SCHED_DONE
+ =
+ = Back off while a task keeps reporting the same value, return to the
+ = base interval as soon as it changes
+ ======================================================================= */
+
+void schedDone(sched_t *sched, int index, long value, long long now) {
+    sched_task_t *task = &sched->tasks[index];
+
+    if (sched->idle)
+        task->intervalMs = task->maxMs;
+    else if (value == task->value)
+        task->intervalMs = MIN(task->intervalMs * 2, task->maxMs);
+    else
+        task->intervalMs = task->baseMs;
+
+    task->value = value;
+    task->runs++;
+
+    // keep the phase unless we fell behind
+    task->due += task->intervalMs;
+    if (task->due <= now)
+        task->due = now + task->intervalMs;
+}
+
+
+/* ========================================================================
+ = SCHED_IDLE
+ =
+ = Enter or leave idle. Leaving it brings tasks that back off to their base
+ = interval and runs them now, fixed rate tasks keep their phase.
+ ======================================================================= */
+
+void schedIdle(sched_t *sched, int idle, long long now) {
+    if (idle == sched->idle)
+        return;
+
+    sched->idle = idle;
+    if (idle)
+        return;
+
+    for (int i = 0; i < sched->count; i++) {
+        sched_task_t *task = &sched->tasks[i];
+
+        if (task->maxMs > task->baseMs) {
+            task->intervalMs = task->baseMs;
+            task->due = MIN(task->due, now);
+        }
+    }
+}
+
+
+/* ========================================================================
+ = SCHED_NEXT
+ =
+ = Earliest deadline of all tasks
+ ======================================================================= */
+
+long long schedNext(const sched_t *sched) {
+    long long next = sched->tasks[0].due;
+
+    for (int i = 1; i < sched->count; i++)
+        next = MIN(next, sched->tasks[i].due);
+
+    return next;
+}
+
+
+/* ========================================================================
+ = SCHED_WAKEUP
+ =
+ = Count a main loop wakeup, returns 1 when a statistics window closed
+ ======================================================================= */
+
+int schedWakeup(sched_t *sched, long long now) {
+    sched->wakeups++;
+    sched->windowWakeups++;
+
+    if (now - sched->windowStart < SCHED_WINDOW_MS)
+        return 0;
+
+    sched->wakeupsPerMin = sched->windowWakeups * 60000 / (now - sched->windowStart);
+    sched->windowWakeups = 0;
+    sched->windowStart = now;
+
+    return 1;
+}
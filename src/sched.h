@@ -0,0 +1,55 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SCHED_H__
+#define __SCHED_H__
+
+#define SCHED_SLACK_MS   50    // tasks due within this window run together
+#define SCHED_WINDOW_MS  60000 // wakeup statistics period
+
+typedef struct {
+    const char *name;
+    long long baseMs;     // interval while the value keeps changing
+    long long maxMs;      // backoff ceiling while it does not
+    long long intervalMs;
+    long long due;        // absolute CLOCK_MONOTONIC milliseconds
+    long value;           // last reported value, -1 before the first run
+    unsigned long runs;
+} sched_task_t;
+
+typedef struct {
+    sched_task_t *tasks;
+    int count;
+    unsigned long wakeups;
+    unsigned long windowWakeups;
+    long long windowStart;
+    unsigned long wakeupsPerMin;
+    int idle;             // nobody watching, every task runs at its ceiling
+} sched_t;
+
+long long nowMs(void);
+long long nowNs(void);
+void schedInit(sched_t *sched, sched_task_t *tasks, int count, long long now);
+int schedConfigure(sched_t *sched, const char *spec);
+int schedDue(sched_t *sched, long long now, int *due);
+void schedDone(sched_t *sched, int task, long value, long long now);
+void schedIdle(sched_t *sched, int idle, long long now);
+long long schedNext(const sched_t *sched);
+int schedWakeup(sched_t *sched, long long now);
+
+#endif // __SCHED_H__
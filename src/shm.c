@@ -0,0 +1,314 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "sysmon.h"
+#include "shm.h"
+
+
+/* ========================================================================
+ = SHM_ALIVE
+ =
+ = Whether the publisher of a segment is still around and committing
+ ======================================================================= */
+
+static int shmAlive(shm_segment_t *segment, long long now) {
+    pid_t pid = atomic_load(&segment->pid);
+
+    if (pid <= 0 || (kill(pid, 0) < 0 && errno == ESRCH))
+        return 0;
+
+    return now - atomic_load(&segment->heartbeat) < SHM_STALE_MS;
+}
+
+
+/* ========================================================================
+ = SHM_CREATE
+ =
+ = Become the publisher of a fresh segment, returns -1 if it exists
+ ======================================================================= */
+
+static int shmCreate(shm_t *shm, long long now) {
+    shm_segment_t *segment;
+    int fd;
+
+    // readable by everyone so a publisher running as root can serve every
+    // user, followers of anyone else only trust their own segments
+    if ((fd = shm_open(shm->name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644)) < 0)
+        return -1;
+
+    if (fchmod(fd, 0644) < 0 || ftruncate(fd, sizeof(shm_segment_t)) < 0) {
+        close(fd);
+        shm_unlink(shm->name);
+        return -1;
+    }
+
+    segment = mmap(NULL, sizeof(shm_segment_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        shm_unlink(shm->name);
+        return -1;
+    }
+
+    segment->sampleSize = sizeof(sample_t);
+    atomic_store(&segment->pid, getpid());
+    atomic_store(&segment->heartbeat, now);
+    atomic_store(&segment->seq, 0);
+    atomic_thread_fence(memory_order_release);
+    segment->magic = SHM_MAGIC;
+
+    shm->segment = segment;
+    shm->role = SHM_PUBLISHER;
+    return 0;
+}
+
+
+/* ========================================================================
+ = SHM_OPEN
+ =
+ = Map an existing segment read-only, returns -1 if it is unusable and
+ = removes it when it is stale and ours to remove
+ ======================================================================= */
+
+static int shmOpen(shm_t *shm, long long now) {
+    struct timespec pause = { 0, 1000000 };
+    shm_segment_t *segment;
+    struct stat st;
+    int fd, usable;
+
+    if ((fd = shm_open(shm->name, O_RDONLY | O_CLOEXEC, 0)) < 0)
+        return -1;
+
+    // another instance may have created it a moment ago and still be
+    // setting it up
+    for (int tries = 0; (usable = fstat(fd, &st) == 0) && st.st_size == 0 && tries < SHM_INIT_TRIES; tries++)
+        nanosleep(&pause, NULL);
+
+    // the name is predictable, anyone could have put a segment there first
+    if (!usable || (st.st_uid != getuid() && st.st_uid != 0) || st.st_size != sizeof(shm_segment_t)) {
+        close(fd);
+        return -1;
+    }
+
+    segment = mmap(NULL, sizeof(shm_segment_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED)
+        return -1;
+
+    for (int tries = 0; segment->magic == 0 && tries < SHM_INIT_TRIES; tries++)
+        nanosleep(&pause, NULL);
+    atomic_thread_fence(memory_order_acquire);
+
+    usable = segment->magic == SHM_MAGIC && segment->sampleSize == sizeof(sample_t);
+    if (!usable || !shmAlive(segment, now)) {
+        munmap(segment, sizeof(shm_segment_t));
+
+        // a crashed publisher leaves the name behind, only its owner may unlink
+        if (usable && st.st_uid == getuid())
+            shm_unlink(shm->name);
+
+        return -1;
+    }
+
+    shm->segment = segment;
+    shm->role = SHM_FOLLOWER;
+    shm->seq = atomic_load(&segment->seq);
+    return 0;
+}
+
+
+/* ========================================================================
+ = SHM_ATTACH
+ =
+ = Follow a live publisher for this configuration, or become one. Returns
+ = the role we ended up with.
+ ======================================================================= */
+
+int shmAttach(shm_t *shm, unsigned int key, long long now) {
+    memset(shm, 0, sizeof(shm_t));
+    shm->role = SHM_LOCAL;
+
+    for (int slot = 0; slot < SHM_SLOTS; slot++) {
+        snprintf(shm->name, sizeof(shm->name), "%s%08x-%d", SHM_PREFIX, key, slot);
+
+        if (shmOpen(shm, now) == 0 || shmCreate(shm, now) == 0)
+            return shm->role;
+    }
+
+    return SHM_LOCAL;
+}
+
+
+/* ========================================================================
+ = SHM_STORE
+ =
+ = Stage a sample for the next commit, collection between two samples
+ = happens outside the seqlock
+ ======================================================================= */
+
+void shmStore(shm_t *shm, const sample_t *sample) {
+    memcpy(&shm->staged[sample->task], sample, sizeof(sample_t));
+    shm->dirty |= 1U << sample->task;
+}
+
+
+/* ========================================================================
+ = SHM_COMMIT
+ =
+ = Publish staged samples under the seqlock and wake followers
+ ======================================================================= */
+
+void shmCommit(shm_t *shm, long long now) {
+    shm_segment_t *segment = shm->segment;
+    unsigned int seq;
+
+    if (shm->role != SHM_PUBLISHER || shm->dirty == 0)
+        return;
+
+    seq = atomic_load_explicit(&segment->seq, memory_order_relaxed);
+    atomic_store_explicit(&segment->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (int i = 0; i < TASK_COUNT; i++) {
+        if (shm->dirty & (1U << i)) {
+            memcpy(&segment->latest[i], &shm->staged[i], sizeof(sample_t));
+            segment->counts[i]++;
+        }
+    }
+
+    atomic_store_explicit(&segment->heartbeat, now, memory_order_relaxed);
+    atomic_store_explicit(&segment->seq, seq + 2, memory_order_release);
+    shm->dirty = 0;
+
+    syscall(SYS_futex, &segment->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+
+/* ========================================================================
+ = SHM_WAIT
+ =
+ = Sleep until the publisher commits or the timeout passes
+ ======================================================================= */
+
+void shmWait(shm_t *shm, int timeoutMs) {
+    struct timespec timeout = { timeoutMs / 1000, timeoutMs % 1000 * 1000000L };
+
+    // returns right away if a commit already happened since our last fetch
+    syscall(SYS_futex, &shm->segment->seq, FUTEX_WAIT, shm->seq, &timeout, NULL, 0);
+}
+
+
+/* ========================================================================
+ = SHM_FETCH
+ =
+ = Copy out samples committed since the last fetch, returns how many or
+ = -1 once the publisher is gone or never lets go of the seqlock
+ ======================================================================= */
+
+int shmFetch(shm_t *shm, sample_t *samples, long long now) {
+    shm_segment_t *segment = shm->segment;
+    unsigned long long counts[TASK_COUNT];
+    sample_t latest[TASK_COUNT];
+    int count = 0, tries = 0;
+
+    while (1) {
+        unsigned int seq = atomic_load_explicit(&segment->seq, memory_order_acquire);
+
+        // a writer that died mid-commit, or anybody else scribbling on the
+        // segment, must not keep us spinning instead of sampling ourselves
+        if (++tries > SHM_READ_TRIES)
+            return -1;
+
+        // the writer only holds it for a few memcpys
+        if (seq & 1) {
+            if (tries % SHM_ALIVE_TRIES == 0 && !shmAlive(segment, now))
+                return -1;
+            sched_yield();
+            continue;
+        }
+
+        memcpy(counts, segment->counts, sizeof(counts));
+        memcpy(latest, segment->latest, sizeof(latest));
+        atomic_thread_fence(memory_order_acquire);
+
+        if (atomic_load_explicit(&segment->seq, memory_order_relaxed) == seq) {
+            shm->seq = seq;
+            break;
+        }
+    }
+
+    if (!shmAlive(segment, now))
+        return -1;
+
+    for (int i = 0; i < TASK_COUNT; i++) {
+        if (counts[i] != shm->seen[i]) {
+            memcpy(&samples[count++], &latest[i], sizeof(sample_t));
+            shm->seen[i] = counts[i];
+        }
+    }
+
+    return count;
+}
+
+
+/* ========================================================================
+ = SHM_PUBLISHER
+ =
+ = Process id of whoever publishes the segment
+ ======================================================================= */
+
+pid_t shmPublisher(const shm_t *shm) {
+    return shm->segment ? atomic_load(&shm->segment->pid) : 0;
+}
+
+
+/* ========================================================================
+ = SHM_DETACH
+ =
+ = Unmap the segment, a publisher also withdraws it so followers take
+ = over right away instead of waiting for it to go stale
+ ======================================================================= */
+
+void shmDetach(shm_t *shm) {
+    if (shm->segment == NULL)
+        return;
+
+    if (shm->role == SHM_PUBLISHER) {
+        atomic_store(&shm->segment->pid, 0);
+        syscall(SYS_futex, &shm->segment->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+        shm_unlink(shm->name);
+    }
+
+    munmap(shm->segment, sizeof(shm_segment_t));
+    shm->segment = NULL;
+    shm->role = SHM_LOCAL;
+}
@@ -0,0 +1,72 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __SHM_H__
+#define __SHM_H__
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+
+#include "sysmon.h"
+
+#define SHM_PREFIX   "/sysmon-"
+#define SHM_SLOTS    4       // segments tried per configuration
+#define SHM_MAGIC    0x53594d31
+#define SHM_STALE_MS 15000   // publisher counts as hung after this long
+#define SHM_CHECK_MS 1000    // followers check publisher liveness this often
+#define SHM_RETRY_MS 5000    // instances sampling on their own retry sharing
+#define SHM_INIT_TRIES 50    // 1 ms waits for a segment that is being created
+#define SHM_READ_TRIES 256   // yields before a seqlock stuck odd counts as dead
+#define SHM_ALIVE_TRIES 32   // liveness checked this often while it is odd
+
+enum {
+    SHM_LOCAL,     // sharing unavailable, sample on our own
+    SHM_PUBLISHER, // we sample and publish for everyone
+    SHM_FOLLOWER   // somebody else samples, we only render
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sampleSize;               // sizeof(sample_t) of the publisher
+    atomic_uint seq;                   // odd while being written, futex word
+    atomic_int pid;                    // publisher, 0 once it exited cleanly
+    atomic_llong heartbeat;            // CLOCK_MONOTONIC ms of the last commit
+    unsigned long long counts[TASK_COUNT]; // samples published per task
+    sample_t latest[TASK_COUNT];
+} shm_segment_t;
+
+typedef struct {
+    shm_segment_t *segment;
+    char name[32];
+    int role;
+    unsigned int seq;                  // follower: last consistent sequence
+    unsigned long long seen[TASK_COUNT];
+    sample_t staged[TASK_COUNT];       // publisher: samples of the current batch
+    unsigned int dirty;
+} shm_t;
+
+int shmAttach(shm_t *shm, unsigned int key, long long now);
+void shmStore(shm_t *shm, const sample_t *sample);
+void shmCommit(shm_t *shm, long long now);
+void shmWait(shm_t *shm, int timeoutMs);
+int shmFetch(shm_t *shm, sample_t *samples, long long now);
+pid_t shmPublisher(const shm_t *shm);
+void shmDetach(shm_t *shm);
+
+#endif // __SHM_H__
@@ -0,0 +1,174 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sysmon.h"
+#include "sched.h"
+#include "stats.h"
+
+#define RELAXED memory_order_relaxed
+
+stats_t stats;
+
+static const char *taskNames[TASK_COUNT] = {
+    [TASK_CPU] = "cpu", [TASK_MEM] = "mem", [TASK_IO] = "io",
+    [TASK_LOADAVG] = "loadavg", [TASK_PSI] = "psi", [TASK_NET] = "net"
+};
+
+static const char *drawNames[DRAW_COUNT] = {
+    [DRAW_METER] = "meter", [DRAW_LOADAVG] = "loadavg", [DRAW_HEATMAP] = "heatmap",
+    [DRAW_PRESSURE] = "pressure", [DRAW_REDRAW] = "redraw"
+};
+
+
+/* ========================================================================
+ = STATS_INIT
+ ======================================================================= */
+
+void statsInit(void) {
+    memset(&stats, 0, sizeof(stats_t));
+    stats.start = nowNs();
+}
+
+
+/* ========================================================================
+ = STATS_COLLECT
+ =
+ = Account one collector run, called on the collector thread
+ ======================================================================= */
+
+void statsCollect(int task, long long ns) {
+    atomic_fetch_add_explicit(&stats.collectNs[task], ns, RELAXED);
+    atomic_fetch_add_explicit(&stats.collectRuns[task], 1, RELAXED);
+}
+
+
+/* ========================================================================
+ = STATS_TICK
+ =
+ = Account a collector wakeup that sampled something, ns is the time from
+ = the wakeup until the renderer was signalled
+ ======================================================================= */
+
+void statsTick(long long ns, unsigned long syscalls) {
+    long long us = ns / 1000;
+    int bucket = 0;
+
+    while (bucket < STATS_BUCKETS - 1 && us >= (1LL << bucket))
+        bucket++;
+
+    atomic_fetch_add_explicit(&stats.ticks, 1, RELAXED);
+    atomic_fetch_add_explicit(&stats.tickHist[bucket], 1, RELAXED);
+    atomic_store_explicit(&stats.syscalls, syscalls, RELAXED);
+
+    // only the collector stores, a plain compare is enough
+    if ((unsigned long long)ns > atomic_load_explicit(&stats.tickMaxNs, RELAXED))
+        atomic_store_explicit(&stats.tickMaxNs, ns, RELAXED);
+}
+
+
+/* ========================================================================
+ = STATS_WAKEUP
+ =
+ = Count a collector thread wakeup
+ ======================================================================= */
+
+void statsWakeup(void) {
+    atomic_fetch_add_explicit(&stats.collectorWakeups, 1, RELAXED);
+}
+
+
+/* ========================================================================
+ = STATS_DRAW
+ =
+ = Account time spent drawing, called on the renderer
+ ======================================================================= */
+
+void statsDraw(int kind, long long ns) {
+    stats.drawNs[kind] += ns;
+    stats.drawCalls[kind]++;
+}
+
+
+/* ========================================================================
+ = STATS_TICK_PERCENTILE
+ =
+ = Tick latency in microseconds below which the given percentage of ticks
+ = fall, rounded up to the histogram bucket
+ ======================================================================= */
+
+long long statsTickPercentile(int percent) {
+    unsigned long ticks = atomic_load_explicit(&stats.ticks, RELAXED), seen = 0;
+
+    if (ticks == 0)
+        return 0;
+
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        seen += atomic_load_explicit(&stats.tickHist[i], RELAXED);
+        if (seen * 100 >= ticks * percent)
+            return 1LL << i;
+    }
+
+    return 1LL << (STATS_BUCKETS - 1);
+}
+
+
+/* ========================================================================
+ = STATS_DUMP
+ =
+ = Print everything counted so far, xRequests is the number of requests
+ = sent to the X server
+ ======================================================================= */
+
+void statsDump(FILE *out, unsigned long xRequests) {
+    unsigned long ticks = atomic_load_explicit(&stats.ticks, RELAXED);
+    double elapsed = (nowNs() - stats.start) / 1e9;
+
+    fprintf(out, "stats: %.1f s since start\n", elapsed);
+
+    for (int i = 0; i < TASK_COUNT; i++) {
+        unsigned long runs = atomic_load_explicit(&stats.collectRuns[i], RELAXED);
+        unsigned long long ns = atomic_load_explicit(&stats.collectNs[i], RELAXED);
+
+        if (runs > 0)
+            fprintf(out, "  collect %-9s %8lu runs %10.1f us avg %10.3f ms total\n",
+                taskNames[i], runs, ns / 1e3 / runs, ns / 1e6);
+    }
+
+    for (int i = 0; i < DRAW_COUNT; i++) {
+        if (stats.drawCalls[i] > 0)
+            fprintf(out, "  draw    %-9s %8lu calls%10.1f us avg %10.3f ms total\n",
+                drawNames[i], stats.drawCalls[i], stats.drawNs[i] / 1e3 / stats.drawCalls[i],
+                stats.drawNs[i] / 1e6);
+    }
+
+    fprintf(out, "  ticks   %lu, latency p50 < %lld us, p99 < %lld us, max %.1f us\n",
+        ticks, statsTickPercentile(50), statsTickPercentile(99),
+        atomic_load_explicit(&stats.tickMaxNs, RELAXED) / 1e3);
+    fprintf(out, "  syscalls %lu, %.1f per tick\n", atomic_load_explicit(&stats.syscalls, RELAXED),
+        ticks ? (double)atomic_load_explicit(&stats.syscalls, RELAXED) / ticks : 0.0);
+    fprintf(out, "  wakeups collector %lu, renderer %lu, %.2f per second\n",
+        atomic_load_explicit(&stats.collectorWakeups, RELAXED), stats.rendererWakeups,
+        (atomic_load_explicit(&stats.collectorWakeups, RELAXED) + stats.rendererWakeups) / MAX(elapsed, 1e-3));
+    fprintf(out, "  x requests %lu, %.1f per drawn batch\n",
+        xRequests, stats.drains ? (double)xRequests / stats.drains : 0.0);
+    fprintf(out, "  x drawing bytes %llu, %.1f per minute\n",
+        stats.xBytes, stats.xBytes * 60.0 / MAX(elapsed, 1e-3));
+}
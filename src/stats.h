@@ -0,0 +1,73 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "sysmon.h"
+
+#define STATS_BUCKETS 32 // tick latency histogram, bucket n holds < 2^n us
+
+// wire size of the requests frames are drawn with, for stats.xBytes
+#define X_COPY_AREA_BYTES     28
+#define X_PUT_IMAGE_BYTES     24 // plus the image rows padded to 32 bits
+#define X_SHM_PUT_IMAGE_BYTES 40
+
+enum {
+    DRAW_METER,
+    DRAW_LOADAVG,
+    DRAW_HEATMAP,
+    DRAW_PRESSURE,
+    DRAW_REDRAW,   // RedrawRegion, also part of the kinds above
+    DRAW_COUNT
+};
+
+/*
+ * Cost of sysmon itself. Collector fields are relaxed atomics as the dump
+ * runs on the renderer, renderer fields are only ever touched there.
+ */
+typedef struct {
+    atomic_ullong collectNs[TASK_COUNT];
+    atomic_ulong collectRuns[TASK_COUNT];
+    atomic_ulong ticks;
+    atomic_ulong tickHist[STATS_BUCKETS];
+    atomic_ullong tickMaxNs;
+    atomic_ulong syscalls;
+    atomic_ulong collectorWakeups;
+    unsigned long long drawNs[DRAW_COUNT];
+    unsigned long drawCalls[DRAW_COUNT];
+    unsigned long rendererWakeups;
+    unsigned long drains;
+    unsigned long long xBytes;  // drawing requests sent to the X server
+    long long start;
+} stats_t;
+
+extern stats_t stats;
+
+void statsInit(void);
+void statsCollect(int task, long long ns);
+void statsTick(long long ns, unsigned long syscalls);
+void statsWakeup(void);
+void statsDraw(int kind, long long ns);
+long long statsTickPercentile(int percent);
+void statsDump(FILE *out, unsigned long xRequests);
+
+#endif // __STATS_H__
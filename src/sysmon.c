@@ -19,16 +19,35 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <time.h>
 #include <unistd.h>
 #include <error.h>
 #include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
 
 #include <X11/Xlib.h>
 #include <X11/xpm.h>
 #include <X11/extensions/shape.h>
 
 #include "sysmon.h"
+#include "meminfo.h"
+#include "sched.h"
+#include "ring.h"
+#include "collector.h"
+#include "metrics.h"
+#include "headless.h"
+#include "stats.h"
+#include "fb.h"
+#include "delta.h"
+#include "comp.h"
+#include "saver.h"
+#include "history.h"
+#include "loadavg.h"
 #include "wmgeneral.h"
 
 #ifdef SIZE_SMALL
@@ -38,15 +57,191 @@
 #  include "sysmon-master.xpm"
 #  include "sysmon-mask.xbm"
 #endif
+#include "atlas.h"  // generated from the master XPM by xpm2atlas
 
+void usage(const char *name);
+void parseArgs(int argc, char *argv[]);
 void createWindow(int argc, char *argv[]);
 void refreshDisplay(void);
 void drawMeter(int x, int y, int amount);
+void drawStackedMeter(int x, int y, const int *amounts, const int *sprites, int count);
 void drawLoadAvg(loadavg_t *loadavg);
-void updateCpuMeter(cpu_stat_t *current, cpu_stat_t *last);
-void updateMemMeter();
-void updateIoMeter(io_stat_t *current, io_stat_t *last);
-void updateLoadMeter(loadavg_t *loadavg);
+void drawHistory(void);
+void drawGraph(loadavg_t *loadavg);
+void recordSample(const sample_t *sample);
+void handleClick(int region, unsigned int button, loadavg_t *loadavg);
+void drawHeatmap(const unsigned char *levels);
+void drawPressure(long long now, int force);
+void drawSelf(void);
+void toggleSelf(loadavg_t *loadavg);
+void repaint(loadavg_t *loadavg);
+void blit(int srcX, int srcY, int width, int height, int dstX, int dstY);
+void redraw(int x, int y, int width, int height);
+int flushFrame(void);
+void drawSample(const sample_t *sample, loadavg_t *loadavg);
+void drainRing(loadavg_t *loadavg);
+int pressureTimeout(long long now);
+int pollTimeout(long long now);
+void updateHidden(loadavg_t *loadavg);
+void handleXEvents(long long arrival, loadavg_t *loadavg);
+void metricsExit(void);
+void openHistory(loadavg_t *loadavg);
+void historyExit(void);
+void updateWallOffset(void);
+
+static options_t options;
+static ring_t ring;
+static metrics_t metrics;
+static headless_t headless;
+static long long stallEnd[PSI_COUNT];
+static sample_t shown[TASK_COUNT]; // meter samples on screen or hidden by the self view
+static int selfShown;
+static fb_t fb;
+static int fbActive; // composing client side, see fb.c
+static delta_t delta;
+static int deltaActive; // fb shadows the master pixmap, see delta.c
+static comp_t comp;
+static saver_t saver;
+static int hidden; // nothing on screen can be seen, drawing is suspended
+static long long exposeArrival; // -v: nowNs when an Expose not yet on screen came in, 0 if none
+static history_t localHistory, *history = &localHistory; // or the mapped file
+static hist_map_t histMap;
+static long long wallOffset; // CLOCK_REALTIME minus CLOCK_MONOTONIC ms, see updateWallOffset
+static int graphMetric = HIST_LOAD; // HIST_*, what the graph shows
+static int graphTier = HIST_10S;    // and at which resolution
+
+static const struct {
+    int srcX, srcY, dstX, dstY, width, height;
+} pressureLabels[] = {
+    { CPU_SRC_X, CPU_SRC_Y, CPU_DST_X, CPU_DST_Y, CPU_WIDTH, CPU_HEIGHT },
+    { MEM_SRC_X, MEM_SRC_Y, MEM_DST_X, MEM_DST_Y, MEM_WIDTH, MEM_HEIGHT },
+#ifndef SIZE_SMALL
+    { IO_SRC_X, IO_SRC_Y, IO_DST_X, IO_DST_Y, IO_WIDTH, IO_HEIGHT }
+#endif
+};
+
+
+/* ========================================================================
+ = USAGE
+ =
+ = Print command line help and exit
+ ======================================================================= */
+
+void usage(const char *name) {
+    fprintf(stderr, "usage: %s [options]\n", name);
+    fprintf(stderr, "  -display <name>          X display to connect to\n");
+    fprintf(stderr, "  -v, --verbose            print per-tick stats and syscall counts\n");
+    fprintf(stderr, "  --cpu total|stacked      single CPU bar (default) or user/sys/\n");
+    fprintf(stderr, "                           iowait/steal segments\n");
+    fprintf(stderr, "  --mem available|classic  used memory as total-MemAvailable (default)\n");
+    fprintf(stderr, "                           or total-(free+buffers+cached)\n");
+    fprintf(stderr, "  --disks <glob>[,...]     devices counted by the IO meter\n");
+    fprintf(stderr, "                           (default: whole disks)\n");
+    fprintf(stderr, "  --net                    show network RX/TX instead of disk IO\n");
+    fprintf(stderr, "  --net-filter <glob>[,...] interfaces counted by the network meter,\n");
+    fprintf(stderr, "                           !glob excludes (default: no loopback,\n");
+    fprintf(stderr, "                           bridges or container veths)\n");
+    fprintf(stderr, "  --cgroup <path>|self     meters relative to a cgroup v2 quota and\n");
+    fprintf(stderr, "                           limits, path under /sys/fs/cgroup\n");
+    fprintf(stderr, "  --shared                 sample once per host, other instances with\n");
+    fprintf(stderr, "                           the same options only render\n");
+    fprintf(stderr, "  --headless csv|json      no X, stream one record per tick instead\n");
+    fprintf(stderr, "  --output <file>          where headless records go (default: stdout)\n");
+    fprintf(stderr, "  --framebuffer            compose frames client side and upload them\n");
+    fprintf(stderr, "                           with one (MIT-SHM) put per window\n");
+    fprintf(stderr, "  --remote                 for ssh -X or VNC, send only pixels that\n");
+    fprintf(stderr, "                           changed, overrides --framebuffer\n");
+    fprintf(stderr, "  --self-view              a click outside the meters and graph switches\n");
+    fprintf(stderr, "                           the meters to sysmon's own\n");
+    fprintf(stderr, "                           collector and drawing time and tick latency\n");
+    fprintf(stderr, "  --metrics <socket>       serve the latest samples in Prometheus text\n");
+    fprintf(stderr, "                           format on a Unix socket\n");
+    fprintf(stderr, "  --history <file>|none    keep the graph history across restarts here\n");
+    fprintf(stderr, "                           (default: $XDG_STATE_HOME/sysmon/history)\n");
+    fprintf(stderr, "  --interval <name>=<ms>[:<max>][,...]\n");
+    fprintf(stderr, "                           sampling interval and idle backoff ceiling\n");
+    fprintf(stderr, "                           of cpu, mem, io, loadavg or psi\n");
+    exit(1);
+}
+
+
+/* ========================================================================
+ = PARSE_ARGS
+ =
+ = Handle command line options
+ ======================================================================= */
+
+void parseArgs(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-display")) {
+            i++; // handled by openXwindow
+        }
+        else if (!strcmp(argv[i], "-v") || !strcmp(argv[i], "--verbose")) {
+            options.verbose = 1;
+        }
+        else if (!strcmp(argv[i], "--mem") && i+1 < argc) {
+            if (!strcmp(argv[++i], "available"))
+                options.memMode = MEM_USED_AVAILABLE;
+            else if (!strcmp(argv[i], "classic"))
+                options.memMode = MEM_USED_CLASSIC;
+            else
+                usage(argv[0]);
+        }
+        else if (!strcmp(argv[i], "--cpu") && i+1 < argc) {
+            if (!strcmp(argv[++i], "total"))
+                options.cpuMode = CPU_METER_TOTAL;
+            else if (!strcmp(argv[i], "stacked"))
+                options.cpuMode = CPU_METER_STACKED;
+            else
+                usage(argv[0]);
+        }
+        else if (!strcmp(argv[i], "--disks") && i+1 < argc) {
+            options.disks = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--net")) {
+            options.net = 1;
+        }
+        else if (!strcmp(argv[i], "--net-filter") && i+1 < argc) {
+            options.netFilter = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--cgroup") && i+1 < argc) {
+            options.cgroup = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--shared")) {
+            options.shared = 1;
+        }
+        else if (!strcmp(argv[i], "--headless") && i+1 < argc) {
+            if ((options.headlessFormat = headlessFormat(argv[++i])) < 0)
+                usage(argv[0]);
+            options.headless = 1;
+        }
+        else if (!strcmp(argv[i], "--output") && i+1 < argc) {
+            options.output = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--framebuffer")) {
+            options.framebuffer = 1;
+        }
+        else if (!strcmp(argv[i], "--remote")) {
+            options.remote = 1;
+        }
+        else if (!strcmp(argv[i], "--self-view")) {
+            options.selfView = 1;
+        }
+        else if (!strcmp(argv[i], "--metrics") && i+1 < argc) {
+            options.metrics = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--history") && i+1 < argc) {
+            options.history = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--interval") && i+1 < argc) {
+            if (collectorConfigure(argv[++i]) < 0)
+                usage(argv[0]);
+        }
+        else {
+            usage(argv[0]);
+        }
+    }
+}
 
 
 /* ========================================================================
@@ -56,14 +251,61 @@ void updateLoadMeter(loadavg_t *loadavg);
  ======================================================================= */
 
 void createWindow(int argc, char *argv[]) {
+    static const XpmAtlas atlas = { atlas_pixels, ATLAS_WIDTH, ATLAS_HEIGHT };
+    Window windows[COMP_WINDOWS];
+    long long start = nowNs();
+
 #ifdef SIZE_SMALL
     openXwindow(argc, argv,
-        sysmon_small_master_xpm, sysmon_small_mask_bits, WIN_WIDTH, WIN_HEIGHT);
+        sysmon_small_master_xpm, &atlas, sysmon_small_mask_bits, WIN_WIDTH, WIN_HEIGHT);
 #else
     openXwindow(argc, argv,
-        sysmon_master_xpm, sysmon_mask_bits, WIN_WIDTH, WIN_HEIGHT);
+        sysmon_master_xpm, &atlas, sysmon_mask_bits, WIN_WIDTH, WIN_HEIGHT);
 #endif
     setMaskXY(0, 0);
+
+    windows[0] = iconwin;
+    windows[1] = win;
+
+    AddMouseRegion(REGION_CPU, CPU_METER_X, CPU_METER_Y,
+        CPU_METER_X + METER_WIDTH - 1, CPU_METER_Y + METER_HEIGHT - 1);
+    AddMouseRegion(REGION_MEM, MEM_METER_X, MEM_METER_Y,
+        MEM_METER_X + METER_WIDTH - 1, MEM_METER_Y + METER_HEIGHT - 1);
+#ifndef SIZE_SMALL
+    AddMouseRegion(REGION_IO, IO_METER_X, IO_METER_Y,
+        IO_METER_X + METER_WIDTH - 1, IO_METER_Y + METER_HEIGHT - 1);
+#endif
+    AddMouseRegion(REGION_GRAPH, LOADAVG_DST_X, LOADAVG_DST_Y,
+        LOADAVG_DST_X + LOAD_HIST_LEN - 1, LOADAVG_DST_Y + LOADAVG_HEIGHT - 1);
+
+    // a shadow of the master pixmap, pulled once, MIT-SHM never works remotely
+    if (options.remote) {
+        if (fbInit(&fb, display, wmgen.pixmap, wmgen.attributes.width, wmgen.attributes.height, iconwin, 0) == 0 &&
+                deltaInit(&delta, fb.image, WIN_WIDTH, WIN_HEIGHT) == 0)
+            deltaActive = 1;
+        else
+            fprintf(stderr, "Remote mode unavailable, copying whole regions\n");
+    }
+    else if (options.framebuffer) {
+        if (fbInit(&fb, display, wmgen.pixmap, wmgen.attributes.width, wmgen.attributes.height, iconwin, 1) == 0)
+            fbActive = 1;
+        else
+            fprintf(stderr, "Framebuffer unavailable, drawing with X requests\n");
+    }
+
+    compInit(&comp, display, wmgen.pixmap, NormalGC, fbActive ? &fb : NULL,
+        deltaActive ? &delta : NULL, windows);
+
+    // DPMS can only be polled, a round trip remote mode does without
+    saverInit(&saver, display, !options.remote, nowMs());
+
+    // startup cost over a remote display is mostly waiting for replies;
+    // Xlib does not say which requests waited, so this counts them all
+    if (options.verbose) {
+        XSync(display, False);
+        fprintf(stderr, "startup: %lu X requests issued, %.1f ms until the first XSync returned\n",
+            NextRequest(display) - 1, (nowNs() - start) / 1e6);
+    }
 }
 
 
@@ -74,19 +316,25 @@ void createWindow(int argc, char *argv[]) {
  ======================================================================= */
 
 void refreshDisplay(void) {
-    copyXPMArea(CPU_SRC_X, CPU_SRC_Y, CPU_WIDTH, CPU_HEIGHT, CPU_DST_X, CPU_DST_Y);
-    copyXPMArea(MEM_SRC_X, MEM_SRC_Y, MEM_WIDTH, MEM_HEIGHT, MEM_DST_X, MEM_DST_Y);
+    blit(CPU_SRC_X, CPU_SRC_Y, CPU_WIDTH, CPU_HEIGHT, CPU_DST_X, CPU_DST_Y);
+    blit(MEM_SRC_X, MEM_SRC_Y, MEM_WIDTH, MEM_HEIGHT, MEM_DST_X, MEM_DST_Y);
 
-    copyXPMArea(METER_BG_X, METER_BG_Y, METER_WIDTH, METER_HEIGHT, CPU_DST_X+CPU_WIDTH+3, CPU_DST_Y);
-    copyXPMArea(METER_BG_X, METER_BG_Y, METER_WIDTH, METER_HEIGHT, MEM_DST_X+MEM_WIDTH+3, MEM_DST_Y);
+    blit(METER_BG_X, METER_BG_Y, METER_WIDTH, METER_HEIGHT, CPU_DST_X+CPU_WIDTH+3, CPU_DST_Y);
+    blit(METER_BG_X, METER_BG_Y, METER_WIDTH, METER_HEIGHT, MEM_DST_X+MEM_WIDTH+3, MEM_DST_Y);
 
 #ifndef SIZE_SMALL
-    copyXPMArea(IO_SRC_X, IO_SRC_Y, IO_WIDTH, IO_HEIGHT, IO_DST_X, IO_DST_Y);
-    copyXPMArea(METER_BG_X, METER_BG_Y, METER_WIDTH, METER_HEIGHT, IO_DST_X+IO_WIDTH+3, IO_DST_Y);
+    if (options.net)
+        blit(NET_SRC_X, NET_SRC_Y, IO_WIDTH, IO_HEIGHT, IO_DST_X, IO_DST_Y);
+    else
+        blit(IO_SRC_X, IO_SRC_Y, IO_WIDTH, IO_HEIGHT, IO_DST_X, IO_DST_Y);
+    blit(METER_BG_X, METER_BG_Y, METER_WIDTH, METER_HEIGHT, IO_DST_X+IO_WIDTH+3, IO_DST_Y);
 #endif
 
-    copyXPMArea(SPACER_SRC_X, SPACER_SRC_Y, SPACER_WIDTH, SPACER_HEIGHT, SPACER_DST_X, SPACER_DST_Y);
-    RedrawWindow();
+    blit(SPACER_SRC_X, SPACER_SRC_Y, SPACER_WIDTH, SPACER_HEIGHT, SPACER_DST_X, SPACER_DST_Y);
+
+    // meters were wiped, whatever they showed has to be drawn again
+    compInvalidate(&comp);
+    redraw(0, 0, WIN_WIDTH, WIN_HEIGHT);
 }
 
 
@@ -97,10 +345,51 @@ void refreshDisplay(void) {
  ======================================================================= */
 
 void drawMeter(int x, int y, int amount) {
-    amount = CLAMP(amount, 0, 100);
-    copyXPMArea(METER_BG_X, METER_BG_Y, METER_WIDTH, METER_HEIGHT, x, y);
-    copyXPMArea(METER_FG_X, METER_FG_Y, amount*METER_WIDTH/100, METER_HEIGHT, x, y);
-    RedrawRegion(x, y, METER_WIDTH, METER_HEIGHT);
+    int state[] = { METER_FG_Y, METER_PIXELS(amount) };
+    long long start = nowNs();
+
+    if (compUnchanged(&comp, x, y, state, sizeof(state)))
+        return;
+
+    blit(METER_BG_X, METER_BG_Y, METER_WIDTH, METER_HEIGHT, x, y);
+    blit(METER_FG_X, METER_FG_Y, METER_PIXELS(amount), METER_HEIGHT, x, y);
+    redraw(x, y, METER_WIDTH, METER_HEIGHT);
+    statsDraw(DRAW_METER, nowNs() - start);
+}
+
+
+/* ========================================================================
+ = DRAW_STACKED_METER
+ =
+ = Display meter made of consecutive segments, each from its own sprite
+ ======================================================================= */
+
+void drawStackedMeter(int x, int y, const int *amounts, const int *sprites, int count) {
+    long long began = nowNs();
+    int sum = 0, start = 0, state[2 * METER_SEGMENTS];
+
+    // cumulative widths so rounding never adds up past the meter
+    for (int i = 0; i < count; i++) {
+        sum = CLAMP(sum + amounts[i], 0, 100);
+        state[2*i] = sprites[i];
+        state[2*i + 1] = METER_PIXELS(sum);
+    }
+
+    if (compUnchanged(&comp, x, y, state, 2 * count * sizeof(int)))
+        return;
+
+    blit(METER_BG_X, METER_BG_Y, METER_WIDTH, METER_HEIGHT, x, y);
+
+    for (int i = 0; i < count; i++) {
+        int end = state[2*i + 1];
+
+        if (end > start)
+            blit(METER_FG_X + start, sprites[i], end - start, METER_HEIGHT, x + start, y);
+        start = end;
+    }
+
+    redraw(x, y, METER_WIDTH, METER_HEIGHT);
+    statsDraw(DRAW_METER, nowNs() - began);
 }
 
 
@@ -111,185 +400,688 @@ void drawMeter(int x, int y, int amount) {
  ======================================================================= */
 
 void drawLoadAvg(loadavg_t *loadavg) {
-    float max = 1.0F;
+    long long start = nowNs();
+    float max = loadAvgMax(loadavg);
+    double state[2] = { max, loadavg->count };
+    double previous[2] = { max, (double)loadavg->count - 1 };
+
+    // a steady load at the same scale leaves every column where it was
+    if (compShows(&comp, VIEW_DST_X, VIEW_DST_Y, state, sizeof(state)))
+        return;
+
+    // same scale one sample back, only the newest column is missing
+    if (compShows(&comp, VIEW_DST_X, VIEW_DST_Y, previous, sizeof(previous))) {
+        int column = MIN(loadavg->count, LOAD_HIST_LEN) - 1;
+        int height = (int)(loadAvgLatest(loadavg) / max * LOADAVG_HEIGHT);
+
+        // scroll the full graph left by one column
+        if (loadavg->count > LOAD_HIST_LEN)
+            blit(LOADAVG_DST_X+1, LOADAVG_DST_Y, LOAD_HIST_LEN-1, LOADAVG_HEIGHT,
+                LOADAVG_DST_X, LOADAVG_DST_Y);
+
+        blit(LOADAVG_CLEAR_X, LOADAVG_DST_Y, LOADAVG_WIDTH, LOADAVG_HEIGHT,
+            LOADAVG_DST_X+column, LOADAVG_DST_Y);
+        blit(LOADAVG_SRC_X, LOADAVG_SRC_Y, LOADAVG_WIDTH, height,
+            LOADAVG_DST_X+column, LOADAVG_DST_Y + LOADAVG_HEIGHT - height);
+
+        if (loadavg->count > LOAD_HIST_LEN)
+            redraw(LOADAVG_DST_X, LOADAVG_DST_Y, LOAD_HIST_LEN, LOADAVG_HEIGHT);
+        else
+            redraw(LOADAVG_DST_X+column, LOADAVG_DST_Y, LOADAVG_WIDTH, LOADAVG_HEIGHT);
+    } else {
+        // clear graph area
+        for (int i = 0; i < LOADAVG_HEIGHT; i++)
+            blit(VIEW_BG_X, VIEW_BG_Y, VIEW_WIDTH, 1, VIEW_DST_X, LOADAVG_DST_Y+i);
+
+        // rescaled or invalidated, draw every column
+        for (int i = 0; i < LOAD_HIST_LEN; i++) {
+            int index = loadavg->isWrapped ? (loadavg->index+i) % LOAD_HIST_LEN : i;
+            int height = (int)(loadavg->history[index] / max * LOADAVG_HEIGHT);
+
+            blit(LOADAVG_SRC_X, LOADAVG_SRC_Y,
+                LOADAVG_WIDTH, height, LOADAVG_DST_X+i, LOADAVG_DST_Y + LOADAVG_HEIGHT - height);
+        }
+
+        redraw(VIEW_DST_X, VIEW_DST_Y, VIEW_WIDTH, VIEW_HEIGHT);
+    }
+
+    compUnchanged(&comp, VIEW_DST_X, VIEW_DST_Y, state, sizeof(state));
+    statsDraw(DRAW_LOADAVG, nowNs() - start);
+}
+
+
+/* ========================================================================
+ = DRAW_HISTORY
+ =
+ = Display the selected metric and tier of the history, one column per
+ = period: its average as a bar with a dot where it peaked
+ ======================================================================= */
+
+void drawHistory(void) {
+    unsigned char state[2 + 2 * HIST_LEN];
+    unsigned char *heights = state + 2, *peaks = state + 2 + HIST_LEN;
+    float avg[HIST_LEN], peak[HIST_LEN], max;
+    long long start = nowNs();
+
+    max = historyColumns(history, graphMetric, graphTier, nowMs() + wallOffset, avg, peak);
 
-    // find highest value for scale
-    for (int i = 0; i < LOAD_HIST_LEN; i++)
-        if (loadavg->history[i] > max) max = loadavg->history[i];
+    // meters are percentages, loadavg scales like its own graph
+    max = graphMetric == HIST_LOAD ? MAX(1.0F, max) : 100.0F;
+
+    state[0] = graphMetric;
+    state[1] = graphTier;
+    for (int i = 0; i < HIST_LEN; i++) {
+        heights[i] = (int)(CLAMP(avg[i] / max, 0.0F, 1.0F) * LOADAVG_HEIGHT);
+        peaks[i] = (int)(CLAMP(peak[i] / max, 0.0F, 1.0F) * LOADAVG_HEIGHT);
+    }
+
+    if (compUnchanged(&comp, VIEW_DST_X, VIEW_DST_Y, state, sizeof(state)))
+        return;
 
     // clear graph area
     for (int i = 0; i < LOADAVG_HEIGHT; i++)
-        copyXPMArea(VIEW_BG_X, VIEW_BG_Y, VIEW_WIDTH, 1, VIEW_DST_X, LOADAVG_DST_Y+i);
+        blit(VIEW_BG_X, VIEW_BG_Y, VIEW_WIDTH, 1, VIEW_DST_X, LOADAVG_DST_Y+i);
 
-    // draw updated graph
-    for (int i = 0; i < LOAD_HIST_LEN; i++) {
-        int index = loadavg->isWrapped ? (loadavg->index+i) % LOAD_HIST_LEN : i;
-        int height = (int)(loadavg->history[index] / max * LOADAVG_HEIGHT);
-        int y = LOADAVG_DST_Y + LOADAVG_HEIGHT - height;
+    for (int i = 0; i < HIST_LEN; i++) {
+        blit(LOADAVG_SRC_X, LOADAVG_SRC_Y, LOADAVG_WIDTH, heights[i],
+            LOADAVG_DST_X+i, LOADAVG_DST_Y + LOADAVG_HEIGHT - heights[i]);
 
-        copyXPMArea(LOADAVG_SRC_X, LOADAVG_SRC_Y,
-            LOADAVG_WIDTH, height, LOADAVG_DST_X+i, y);
+        if (peaks[i] > heights[i])
+            blit(HIST_PEAK_SRC_X, HIST_PEAK_SRC_Y, 1, 1,
+                LOADAVG_DST_X+i, LOADAVG_DST_Y + LOADAVG_HEIGHT - peaks[i]);
     }
 
-    RedrawRegion(VIEW_DST_X, VIEW_DST_Y, VIEW_WIDTH, VIEW_HEIGHT);
+    redraw(VIEW_DST_X, VIEW_DST_Y, VIEW_WIDTH, VIEW_HEIGHT);
+    statsDraw(DRAW_LOADAVG, nowNs() - start);
+}
+
+
+/* ========================================================================
+ = DRAW_GRAPH
+ =
+ = Display whichever graph is selected, the default loadavg one scrolls
+ = incrementally
+ ======================================================================= */
+
+void drawGraph(loadavg_t *loadavg) {
+    if (graphMetric == HIST_LOAD && graphTier == HIST_10S)
+        drawLoadAvg(loadavg);
+    else
+        drawHistory();
 }
 
 
 /* ========================================================================
- = UPDATE_CPU_METER
+ = DRAW_HEATMAP
  =
- = Gather CPU stats and update meter
+ = Display busiest cores as a strip of shaded cells
  ======================================================================= */
 
-void updateCpuMeter(cpu_stat_t *current, cpu_stat_t *last) {
-    long int user, nice, sys, idle;
-    long int dt, da, usage;
-    FILE *procFile;
+void drawHeatmap(const unsigned char *levels) {
+    long long start = nowNs();
 
-    if ((procFile = fopen(PROC_STATS, "r")) == NULL) {
-        fprintf(stderr, "Cannot open '%s' for reading: %s\n", PROC_STATS, strerror(errno));
-        exit(1);
+    if (compUnchanged(&comp, HEAT_DST_X, HEAT_DST_Y, levels, HEAT_CELLS))
+        return;
+
+    for (int i = 0; i < HEAT_CELLS; i++) {
+        blit(HEAT_SRC_X + levels[i]*HEAT_CELL_WIDTH, HEAT_SRC_Y, HEAT_CELL_WIDTH, HEAT_HEIGHT,
+            HEAT_DST_X + i*HEAT_CELL_STEP, HEAT_DST_Y);
     }
 
-    fscanf(procFile, "cpu %ld %ld %ld %ld", &user, &nice, &sys, &idle);
-    fclose(procFile);
+    redraw(HEAT_DST_X, HEAT_DST_Y, HEAT_CELLS*HEAT_CELL_STEP, HEAT_HEIGHT);
+    statsDraw(DRAW_HEATMAP, nowNs() - start);
+}
+
+
+/* ========================================================================
+ = DRAW_PRESSURE
+ =
+ = Light up meter labels while their resource is stalled
+ ======================================================================= */
 
-    memcpy(last, current, sizeof(cpu_stat_t));
-    current->active = (user + nice + sys);
-    current->idle = idle;
-    current->total = current->active + current->idle;
+void drawPressure(long long now, int force) {
+    static int lit[PSI_COUNT];
+    long long start = nowNs();
+    int drawn = 0, count = sizeof(pressureLabels) / sizeof(pressureLabels[0]);
+
+    // the network meter takes over the IO label
+    if (options.net)
+        count = MIN(count, PSI_IO);
+
+    for (int i = 0; i < count; i++) {
+        int stalled = now < stallEnd[i];
+
+        if (!force && stalled == lit[i])
+            continue;
 
-    dt = MAX(1, current->total - last->total);
-    da = MAX(0, current->active - last->active);
-    usage = da*100 / dt;
+        lit[i] = stalled;
+        drawn = 1;
+        blit(pressureLabels[i].srcX, stalled ? ALERT_SRC_Y : pressureLabels[i].srcY,
+            pressureLabels[i].width, pressureLabels[i].height,
+            pressureLabels[i].dstX, pressureLabels[i].dstY);
+        redraw(pressureLabels[i].dstX, pressureLabels[i].dstY,
+            pressureLabels[i].width, pressureLabels[i].height);
+    }
 
-    drawMeter(CPU_METER_X, CPU_METER_Y, usage);
+    // most calls only find nothing changed, those are not worth counting
+    if (drawn)
+        statsDraw(DRAW_PRESSURE, nowNs() - start);
 }
 
 
 /* ========================================================================
- = UPDATE_MEM_METER
+ = DRAW_SELF
  =
- = Gather memory stats and update meter
+ = Show sysmon's own cost on the meters: collector and drawing time as
+ = share of one core, full at SELF_CPU_FULL percent, and p99 tick latency
+ = against the scheduler slack
  ======================================================================= */
 
-void updateMemMeter() {
-    long int total = -1, active = -1, unused = -1, buffers = -1, cached = -1;
-    FILE *procFile;
-    char buf[128];
+void drawSelf(void) {
+    static unsigned long long lastCollect, lastDraw;
+    static long long last;
+    unsigned long long collect = 0, draw = 0;
+    long long now = nowNs();
 
-    if ((procFile = fopen(PROC_MEMINFO, "r")) == NULL) {
-        fprintf(stderr, "Cannot open '%s' for reading: %s\n", PROC_MEMINFO, strerror(errno));
-        exit(1);
+    for (int i = 0; i < TASK_COUNT; i++)
+        collect += atomic_load_explicit(&stats.collectNs[i], memory_order_relaxed);
+    for (int i = 0; i < DRAW_REDRAW; i++)
+        draw += stats.drawNs[i];
+
+    if (last > 0 && now > last) {
+        double window = (now - last) * SELF_CPU_FULL / 100.0;
+
+        drawMeter(CPU_METER_X, CPU_METER_Y, CLAMP((int)((collect - lastCollect) * 100 / window), 0, 100));
+        drawMeter(MEM_METER_X, MEM_METER_Y, CLAMP((int)((draw - lastDraw) * 100 / window), 0, 100));
+#ifndef SIZE_SMALL
+        drawMeter(IO_METER_X, IO_METER_Y,
+            CLAMP((int)(statsTickPercentile(99) / 10 / SCHED_SLACK_MS), 0, 100));
+#endif
     }
 
-    while (fgets(buf, sizeof(buf), procFile) != NULL) {
-        char *token;
+    lastCollect = collect;
+    lastDraw = draw;
+    last = now;
+}
 
-        if ((token = strtok(buf, " ")) == NULL)
-            continue;
 
-        if (!strncmp(token, "MemTotal:", 9)) {
-            token = strtok(NULL, " ");
-            total = MAX(1, atoi(token));
-        }
-        else if (!strncmp(token, "MemFree:", 8)) {
-            token = strtok(NULL, " ");
-            unused = MAX(0, atoi(token));
-        }
-        else if (!strncmp(token, "Buffers:", 8)) {
-            token = strtok(NULL, " ");
-            buffers = MAX(0, atoi(token));
+/* ========================================================================
+ = TOGGLE_SELF
+ =
+ = Flip between the regular meters and the self view
+ ======================================================================= */
+
+void toggleSelf(loadavg_t *loadavg) {
+    selfShown = !selfShown;
+
+    if (selfShown) {
+        drawSelf();
+        return;
+    }
+
+    // back to the samples the self view was covering
+    for (int i = 0; i < TASK_COUNT; i++)
+        if (shown[i].stamp)
+            drawSample(&shown[i], loadavg);
+}
+
+
+/* ========================================================================
+ = REPAINT
+ =
+ = Draw everything again after the background was restored
+ ======================================================================= */
+
+void repaint(loadavg_t *loadavg) {
+    for (int i = 0; i < TASK_COUNT; i++)
+        if (shown[i].stamp)
+            drawSample(&shown[i], loadavg);
+
+    drawGraph(loadavg);
+    drawPressure(nowMs(), 1);
+}
+
+
+/* ========================================================================
+ = BLIT
+ =
+ = Copy a sprite within the master pixmap, or its client side copy. With
+ = a shadow, copies that leave every pixel as it was are not sent.
+ ======================================================================= */
+
+void blit(int srcX, int srcY, int width, int height, int dstX, int dstY) {
+    if (fbActive) {
+        fbCopy(&fb, srcX, srcY, width, height, dstX, dstY);
+        return;
+    }
+
+    if (deltaActive && !fbCopy(&fb, srcX, srcY, width, height, dstX, dstY))
+        return;
+
+    copyXPMArea(srcX, srcY, width, height, dstX, dstY);
+    stats.xBytes += X_COPY_AREA_BYTES;
+}
+
+
+/* ========================================================================
+ = REDRAW
+ =
+ = Note a region for the copy to the windows at the end of the frame,
+ = timed on its own
+ ======================================================================= */
+
+void redraw(int x, int y, int width, int height) {
+    long long start = nowNs();
+
+    compDamage(&comp, x, y, width, height);
+    statsDraw(DRAW_REDRAW, nowNs() - start);
+}
+
+
+/* ========================================================================
+ = FLUSH_FRAME
+ =
+ = Send what the frame changed, with -v the first frame on screen reports
+ = how long startup took
+ ======================================================================= */
+
+int flushFrame(void) {
+    static int first = 1;
+    int requests = compFlush(&comp);
+
+    if (options.verbose && first && requests > 0) {
+        XSync(display, False);
+        fprintf(stderr, "first frame: %.1f ms after start\n", (nowNs() - stats.start) / 1e6);
+        first = 0;
+    }
+
+    // the repaint only reaches the server with the frame
+    if (exposeArrival) {
+        XSync(display, False);
+        fprintf(stderr, "expose: redrawn %.2f ms after it arrived\n", (nowNs() - exposeArrival) / 1e6);
+        exposeArrival = 0;
+    }
+
+    return requests;
+}
+
+
+/* ========================================================================
+ = RECORD_SAMPLE
+ =
+ = Roll a sample into the history of the metric it carries
+ ======================================================================= */
+
+void recordSample(const sample_t *sample) {
+    long long stamp = sample->stamp + wallOffset;
+
+    switch (sample->task) {
+        case TASK_CPU:
+            historyAdd(history, HIST_CPU, stamp, sample->cpu.total);
+            break;
+        case TASK_MEM:
+            historyAdd(history, HIST_MEM, stamp, sample->mem.percent);
+            break;
+        case TASK_IO:
+            if (sample->io.percent >= 0)
+                historyAdd(history, HIST_IO, stamp, sample->io.percent);
+            break;
+        case TASK_NET:
+            // as long as the stacked meter is
+            if (sample->net.amounts[0] >= 0)
+                historyAdd(history, HIST_IO, stamp,
+                    MIN(100, sample->net.amounts[0] + sample->net.amounts[1]));
+            break;
+        case TASK_LOADAVG:
+            historyAdd(history, HIST_LOAD, stamp, sample->loadavg[0]);
+            break;
+    }
+}
+
+
+/* ========================================================================
+ = DRAW_SAMPLE
+ =
+ = Update the part of the display a sample belongs to
+ ======================================================================= */
+
+void drawSample(const sample_t *sample, loadavg_t *loadavg) {
+    static const int sprites[] = { METER_FG_Y, METER_SYS_Y, METER_IOWAIT_Y, METER_STEAL_Y };
+
+    // meters are kept up to date underneath the self view
+    if (sample->task != TASK_LOADAVG && sample->task != TASK_PSI) {
+        if (sample != &shown[sample->task])
+            memcpy(&shown[sample->task], sample, sizeof(sample_t));
+        if (selfShown || hidden)
+            return;
+    }
+
+    switch (sample->task) {
+        case TASK_CPU:
+            if (options.cpuMode == CPU_METER_STACKED)
+                drawStackedMeter(CPU_METER_X, CPU_METER_Y, sample->cpu.amounts, sprites, 4);
+            else
+                drawMeter(CPU_METER_X, CPU_METER_Y, sample->cpu.total);
+            drawHeatmap(sample->cpu.heat);
+            break;
+        case TASK_MEM:
+            drawMeter(MEM_METER_X, MEM_METER_Y, sample->mem.percent);
+            break;
+        case TASK_IO:
+#ifndef SIZE_SMALL
+            if (sample->io.percent >= 0)
+                drawMeter(IO_METER_X, IO_METER_Y, sample->io.percent);
+#endif
+            break;
+        case TASK_NET:
+#ifndef SIZE_SMALL
+            if (sample->net.amounts[0] >= 0)
+                drawStackedMeter(IO_METER_X, IO_METER_Y, sample->net.amounts, sprites, 2);
+#endif
+            break;
+        case TASK_LOADAVG:
+            // the history goes on while hidden, it is drawn when shown again
+            loadAvgPush(loadavg, sample->loadavg[0]);
+            if (!hidden && graphMetric == HIST_LOAD && graphTier == HIST_10S)
+                drawLoadAvg(loadavg);
+            break;
+        case TASK_PSI:
+            memcpy(stallEnd, sample->pressure.stallEnd, sizeof(stallEnd));
+            if (!hidden)
+                drawPressure(nowMs(), 0);
+            break;
+    }
+}
+
+
+/* ========================================================================
+ = DRAIN_RING
+ =
+ = Take everything the collector published and draw the newest sample of
+ = each kind, loadavg samples all go into the graph
+ ======================================================================= */
+
+void drainRing(loadavg_t *loadavg) {
+    static unsigned long overwritten, dropped;
+    sample_t sample, latest[TASK_COUNT];
+    int have[TASK_COUNT] = { 0 };
+
+    stats.drains++;
+
+    // samples in the ring are moments old, taken since the last resume
+    if (!options.headless)
+        updateWallOffset();
+
+    while (ringPop(&ring, &sample)) {
+        metricsUpdate(&metrics, &sample);
+
+        if (options.headless) {
+            headlessUpdate(&headless, &sample);
+            continue;
         }
-        else if (!strncmp(token, "Cached:", 7)) {
-            token = strtok(NULL, " ");
-            cached = MAX(0, atoi(token));
+
+        // every sample, the meters below only draw the latest
+        recordSample(&sample);
+
+        if (sample.task == TASK_LOADAVG) {
+            drawSample(&sample, loadavg);
+            continue;
         }
+
+        if (have[sample.task])
+            ring.dropped++;
+
+        memcpy(&latest[sample.task], &sample, sizeof(sample_t));
+        have[sample.task] = 1;
     }
 
-    fclose(procFile);
+    for (int i = 0; i < TASK_COUNT; i++)
+        if (have[i])
+            drawSample(&latest[i], loadavg);
 
-    if (total == -1 || unused == -1 || buffers == -1 || cached == -1) {
-        fprintf(stderr, "Failed to read required fields from '%s'!\n", PROC_MEMINFO);
-        exit(1);
+    if (options.headless)
+        headlessEmit(&headless);
+    else if (selfShown && !hidden)
+        drawSelf();
+
+    // the loadavg graph at its own rate draws itself as samples come in
+    if (!options.headless && !hidden && (graphMetric != HIST_LOAD || graphTier != HIST_10S))
+        drawHistory();
+
+    if (!options.headless)
+        historySync(&histMap, nowMs());
+
+    // once per batch, scrapes in between are served the ready buffer
+    metricsRender(&metrics, &ring);
+
+    if (options.verbose && (ring.overwritten != overwritten || ring.dropped != dropped)) {
+        fprintf(stderr, "ring: %lu samples overwritten, %lu dropped\n", ring.overwritten, ring.dropped);
+        overwritten = ring.overwritten;
+        dropped = ring.dropped;
     }
+}
+
+
+/* ========================================================================
+ = PRESSURE_TIMEOUT
+ =
+ = Milliseconds until a lit stall label has to go dark, -1 if none is lit
+ ======================================================================= */
+
+int pressureTimeout(long long now) {
+    long long next = -1;
 
-    active = total - (unused + buffers + cached);
-    drawMeter(MEM_METER_X, MEM_METER_Y, (active*100 / total));
+    for (int i = 0; i < PSI_COUNT; i++)
+        if (stallEnd[i] > now && (next < 0 || stallEnd[i] < next))
+            next = stallEnd[i];
+
+    return next < 0 ? -1 : (int)(next - now);
 }
 
 
 /* ========================================================================
- = UPDATE_IO_METER
+ = POLL_TIMEOUT
  =
- = Gather disk IO stats and update meter
+ = Sleep until a stall indicator expires or DPMS is due to be asked, -1 for
+ = no timeout. Nothing expires on a hidden display.
  ======================================================================= */
 
-void updateIoMeter(io_stat_t *current, io_stat_t *last) {
-    FILE *procFile;
-    char buf[128];
-    long int delta;
+int pollTimeout(long long now) {
+    int pressure = hidden ? -1 : pressureTimeout(now);
+    int screen = options.headless ? -1 : saverTimeout(&saver, now);
 
-    if ((procFile = fopen(PROC_DISKSTATS, "r")) == NULL) {
-        fprintf(stderr, "Cannot open '%s' for reading: %s\n", PROC_DISKSTATS, strerror(errno));
-        exit(1);
+    if (pressure < 0 || screen < 0)
+        return MAX(pressure, screen);
+
+    return MIN(pressure, screen);
+}
+
+
+/* ========================================================================
+ = UPDATE_HIDDEN
+ =
+ = Suspend drawing while no window can be seen or the screen is blank,
+ = rebuild the whole display in one frame once it can be seen again
+ ======================================================================= */
+
+void updateHidden(loadavg_t *loadavg) {
+    int now = !compVisible(&comp) || saverBlank(&saver);
+
+    if (now == hidden)
+        return;
+
+    hidden = now;
+    collectorIdle(hidden);
+
+    if (options.verbose)
+        fprintf(stderr, "display %s\n", hidden ? "hidden, drawing suspended" : "visible, redrawn");
+
+    if (!hidden) {
+        refreshDisplay();
+        repaint(loadavg);
+    }
+}
+
+
+/* ========================================================================
+ = HANDLE_CLICK
+ =
+ = A meter puts its metric on the graph, or loadavg back if it is already
+ = there. On the graph the left button or wheel down zooms out to longer
+ = periods, the right button or wheel up zooms in.
+ ======================================================================= */
+
+void handleClick(int region, unsigned int button, loadavg_t *loadavg) {
+    static const int metrics[] = {
+        [REGION_CPU] = HIST_CPU, [REGION_MEM] = HIST_MEM, [REGION_IO] = HIST_IO
+    };
+
+    if (region == REGION_GRAPH) {
+        if (button == Button1 || button == Button5)
+            graphTier = (graphTier + 1) % HIST_TIERS;
+        else if (button == Button3 || button == Button4)
+            graphTier = (graphTier + HIST_TIERS - 1) % HIST_TIERS;
+        else
+            return;
     }
+    else {
+        graphMetric = graphMetric == metrics[region] ? HIST_LOAD : metrics[region];
+    }
+
+    if (options.verbose)
+        fprintf(stderr, "graph: %s per %s\n", histMetricNames[graphMetric], histTierNames[graphTier]);
+
+    if (!hidden)
+        drawGraph(loadavg);
+}
 
-    // TODO: allow user to specify disk(s) to monitor
-    memcpy(last, current, sizeof(io_stat_t));
-    memset(current, 0, sizeof(io_stat_t));
-    while (fgets(buf, sizeof(buf), procFile) != NULL) {
-        char *token;
 
-        if ((token = strtok(buf, " ")) == NULL) continue; // major
-        if ((token = strtok(NULL, " ")) == NULL) continue; // minor
-        if ((token = strtok(NULL, " ")) == NULL) continue; // device
+/* ========================================================================
+ = HANDLE_X_EVENTS
+ =
+ = Drain everything Xlib has queued or can read without blocking. Arrival
+ = is when the connection was seen readable, nowNs of the poll wakeup,
+ = the Expose latency -v reports runs from there to the flushed frame.
+ ======================================================================= */
+
+void handleXEvents(long long arrival, loadavg_t *loadavg) {
+    XEvent Event;
 
-        if (!strncmp(token, "sd", 2) && strlen(token) == 3) {
-            for (int i = 0; i < 11; i++)
-                if ((token = strtok(NULL, " ")) == NULL) break;
-            current->weighted += MAX(0, atoi(token));
+    while (XPending(display)) {
+        XNextEvent(display, &Event);
+        compEvent(&comp, &Event);
+        saverEvent(&saver, &Event);
+
+        switch (Event.type) {
+            case Expose:
+                refreshDisplay();
+                repaint(loadavg);
+                if (options.verbose && !exposeArrival)
+                    exposeArrival = arrival;
+                break;
+            case ButtonPress: {
+                int region = CheckMouseRegion(Event.xbutton.x, Event.xbutton.y);
+
+                if (region >= 0)
+                    handleClick(region, Event.xbutton.button, loadavg);
+                else if (options.selfView)
+                    toggleSelf(loadavg);
+                break;
+            }
+            case DestroyNotify:
+                XCloseDisplay(display);
+                exit(0);
+                break;
+            default:
+                // printf("unhandled event: %d\n", Event.type);
+                break;
         }
     }
 
-    fclose(procFile);
+    updateHidden(loadavg);
+}
 
-    // max was reset, wait until enough data has been cycled through
-    if (current->max == -1 || last->max == -1) return;
 
-    delta = current->weighted - last->weighted;
-    current->max = MAX(1, delta > last->max ? delta : last->max);
+/* ========================================================================
+ = METRICS_EXIT
+ =
+ = Remove the metrics socket on the way out
+ ======================================================================= */
 
-    drawMeter(IO_METER_X, IO_METER_Y, delta*100 / current->max);
+void metricsExit(void) {
+    metricsClose(&metrics);
 }
 
 
 /* ========================================================================
- = UPDATE_LOAD_METER
+ = OPEN_HISTORY
  =
- = Gather load average stats and update meter
+ = Record into the history file of an earlier run and refill the loadavg
+ = graph from it, so a restart draws it right away
  ======================================================================= */
 
-void updateLoadMeter(loadavg_t *loadavg) {
-    FILE *procFile;
-    float value;
+void openHistory(loadavg_t *loadavg) {
+    char path[PATH_MAX];
+    float recent[HIST_LEN];
+    history_t *mapped;
+    int count;
 
-    if ((procFile = fopen(PROC_LOADAVG, "r")) == NULL) {
-        fprintf(stderr, "Cannot open '%s' for reading: %s\n", PROC_LOADAVG, strerror(errno));
-        exit(1);
-    }
+    updateWallOffset();
 
-    fscanf(procFile, "%f", &value);
-    fclose(procFile);
+    if (options.history != NULL && !strcmp(options.history, "none"))
+        return;
 
-    loadavg->history[loadavg->index++] = value;
+    if (options.history != NULL)
+        snprintf(path, sizeof(path), "%s", options.history);
+    else if (historyPath(path, sizeof(path)) < 0) {
+        if (options.verbose)
+            fprintf(stderr, "history: no state directory, kept in memory\n");
+        return;
+    }
 
-    if (loadavg->index >= LOAD_HIST_LEN) {
-        loadavg->index = 0;
-        loadavg->isWrapped = 1;
+    if ((mapped = historyMap(&histMap, path)) == NULL) {
+        if (options.verbose)
+            fprintf(stderr, "history: cannot use %s, kept in memory\n", path);
+        return;
     }
 
-    drawLoadAvg(loadavg);
+    history = mapped;
+    atexit(historyExit);
+
+    // the graph scrolls per sample, LOADAVG_INTERVAL apart like the tier
+    count = historyRecent(history, HIST_LOAD, HIST_10S, nowMs() + wallOffset, recent);
+    for (int i = 0; i < count; i++)
+        loadAvgPush(loadavg, recent[i]);
+
+    if (options.verbose)
+        fprintf(stderr, "history: %s, %d loadavg samples restored\n", path, count);
+}
+
+
+/* ========================================================================
+ = UPDATE_WALL_OFFSET
+ =
+ = History is stamped in wall clock time so it lines up across restarts.
+ = CLOCK_MONOTONIC stops during suspend, so the offset to it is taken again
+ = with every batch of samples rather than once.
+ ======================================================================= */
+
+void updateWallOffset(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    wallOffset = ts.tv_sec * 1000LL + ts.tv_nsec / 1000000 - nowMs();
+}
+
+
+/* ========================================================================
+ = HISTORY_EXIT
+ =
+ = Write the history back on the way out
+ ======================================================================= */
+
+void historyExit(void) {
+    historyUnmap(&histMap);
 }
 
 
@@ -300,49 +1092,117 @@ void updateLoadMeter(loadavg_t *loadavg) {
  ======================================================================= */
 
 int main(int argc, char *argv[]) {
-    XEvent Event;
-    stat_t current, last;
+    enum { FD_X, FD_WAKE, FD_METRICS, FD_SIGNAL, FD_COUNT };
+    struct pollfd fds[FD_COUNT];
     loadavg_t loadavg;
-    time_t now;
+    sigset_t mask;
 
-    memset(&current, 0, sizeof(current));
-    memset(&last, 0, sizeof(last));
     memset(&loadavg, 0, sizeof(loadavg));
+    historyInit(&localHistory);
 
-    current.io.max = -1; // signal that max has been reset
+    statsInit();
+    ringInit(&ring);
+    collectorInit(&options);
+    parseArgs(argc, argv);
 
-    createWindow(argc, argv);
-    refreshDisplay();
+    // headless never touches X, poll skips the negative fd
+    if (options.headless) {
+        headlessOpen(&headless, options.headlessFormat, options.output);
+        fds[FD_X].fd = -1;
+    }
+    else {
+        openHistory(&loadavg);
+        createWindow(argc, argv);
+        refreshDisplay();
+        drawPressure(nowMs(), 1);
+        fds[FD_X].fd = x_fd;
+    }
+    fds[FD_X].events = POLLIN;
+    if ((fds[FD_WAKE].fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        fprintf(stderr, "Cannot create eventfd: %s\n", strerror(errno));
+        exit(1);
+    }
+    fds[FD_WAKE].events = POLLIN;
+
+    // poll ignores the entry while the endpoint is disabled
+    metricsOpen(&metrics, options.metrics);
+    atexit(metricsExit);
+    fds[FD_METRICS].fd = metrics.pollFd;
+    fds[FD_METRICS].events = POLLIN;
+
+    // blocked before the collector starts so it inherits the mask
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    if ((fds[FD_SIGNAL].fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) < 0) {
+        fprintf(stderr, "Cannot create signalfd: %s\n", strerror(errno));
+        exit(1);
+    }
+    fds[FD_SIGNAL].events = POLLIN;
 
-    while (1) {
-        updateCpuMeter(&current.cpu, &last.cpu);
-        updateMemMeter();
-#ifndef SIZE_SMALL
-        updateIoMeter(&current.io, &last.io);
-#endif
+    collectorStart(&ring, fds[FD_WAKE].fd);
 
-        now = time(NULL);
-        if ((now - loadavg.lastUpdate) > LOADAVG_INTERVAL) {
-            updateLoadMeter(&loadavg);
-            loadavg.lastUpdate = now;
+    while (1) {
+        unsigned long requests = options.headless ? 0 : NextRequest(display);
+        unsigned long long bytes = stats.xBytes;
+        int drained = 0;
+        long long wake, wakeNs;
+
+        // XPending flushes our requests and picks up events already read
+        if (!options.headless)
+            handleXEvents(nowNs(), &loadavg);
+
+        // an Expose repaint must not wait for the next sample
+        if (!options.headless && flushFrame() > 0)
+            XFlush(display);
+
+        if (poll(fds, FD_COUNT, pollTimeout(nowMs())) < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "poll failed: %s\n", strerror(errno));
+            exit(1);
         }
 
-        while (XPending(display)) {
-            XNextEvent(display, &Event);
-            switch (Event.type) {
-                case Expose:
-                    refreshDisplay();
-                    break;
-                case DestroyNotify:
-                    XCloseDisplay(display);
-                    exit(0);
-                    break;
-                default:
-                    // printf("unhandled event: %d\n", Event.type);
-                    break;
+        // X first, so an Expose never waits behind sample drawing
+        wakeNs = nowNs();
+        wake = wakeNs / 1000000;
+        stats.rendererWakeups++;
+        if (fds[FD_X].revents)
+            handleXEvents(wakeNs, &loadavg);
+
+        if (!options.headless && saverPoll(&saver, wake))
+            updateHidden(&loadavg);
+
+        if (fds[FD_WAKE].revents & POLLIN) {
+            uint64_t count;
+
+            if (read(fds[FD_WAKE].fd, &count, sizeof(count)) > 0) {
+                drainRing(&loadavg);
+                drained = 1;
             }
         }
-        usleep(250000L);
+
+        if (fds[FD_METRICS].revents & POLLIN)
+            metricsServe(&metrics, wake);
+
+        if (fds[FD_SIGNAL].revents & POLLIN) {
+            struct signalfd_siginfo info;
+
+            if (read(fds[FD_SIGNAL].fd, &info, sizeof(info)) > 0)
+                statsDump(stderr, options.headless ? 0 : NextRequest(display) - 1);
+        }
+
+        if (options.headless)
+            continue;
+
+        if (!hidden)
+            drawPressure(nowMs(), 0);
+
+        // the whole frame goes out in one batch to the visible window
+        flushFrame();
+
+        if (options.verbose && drained)
+            fprintf(stderr, "frame: %lu X requests, %llu bytes\n",
+                NextRequest(display) - requests, stats.xBytes - bytes);
     }
     return 0;
 }
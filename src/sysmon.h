@@ -19,6 +19,12 @@
 #ifndef __SYSMON_H__
 #define __SYSMON_H__
 
+#include <time.h>
+
+#include "proc.h"
+#include "cpu.h"
+#include "psi.h"
+
 #ifdef SIZE_SMALL
 #  define LOAD_HIST_LEN 48
 #else
@@ -29,25 +35,88 @@ typedef struct {
     long int active;
     long int idle;
     long int total;
+    proc_stat_t fields;
+    long long stamp; // CLOCK_MONOTONIC milliseconds
+    int user;        // percent of total since last sample, includes nice
+    int sys;         // includes irq and softirq
+    int iowait;
+    int steal;
+    long int ctxtRate;
+    long int forkRate;
 } cpu_stat_t;
 
 typedef struct {
     long int weighted;
     long int max;
+    long long stamp; // CLOCK_MONOTONIC milliseconds
 } io_stat_t;
 
+typedef struct {
+    unsigned long long rx;
+    unsigned long long tx;
+    long int max;    // peak bytes per tick, -1 until there is a delta
+    long long stamp; // CLOCK_MONOTONIC milliseconds
+    unsigned long generation; // monitored interface set the counters came from
+} net_stat_t;
+
 typedef struct {
     float history[LOAD_HIST_LEN];
     int index;
     int isWrapped;
-    time_t lastUpdate;
+    unsigned long count;       // samples pushed so far
+    int deque[LOAD_HIST_LEN];  // history slots with decreasing values, max first
+    int dequeHead;
+    int dequeLen;
 } loadavg_t;
 
 typedef struct {
     cpu_stat_t cpu;
     io_stat_t io;
+    net_stat_t net;
 } stat_t;
 
+typedef struct {
+    proc_file_t stat;
+    proc_file_t meminfo;
+    proc_file_t diskstats;
+    proc_file_t loadavg;
+    proc_file_t netdev;
+} sources_t;
+
+typedef struct {
+    int verbose;
+    int memMode;
+    int cpuMode;
+    const char *disks;
+    int net;              // third meter shows network instead of disk IO
+    const char *netFilter;
+    const char *cgroup;   // scope meters to this cgroup v2 path
+    int shared;           // share samples with other instances on the host
+    const char *metrics;  // Unix socket serving Prometheus text format
+    int headless;         // no X, stream records instead of drawing
+    int headlessFormat;   // HEADLESS_*
+    const char *output;   // headless records file, stdout if unset
+    int selfView;         // a click shows sysmon's own cost on the meters
+    int framebuffer;      // compose client side, one upload per frame
+    int remote;           // send only pixels that changed, for remote displays
+    const char *history;  // persistent history file, "none" keeps it in memory
+} options_t;
+
+enum {
+    CPU_METER_TOTAL,
+    CPU_METER_STACKED
+};
+
+enum {
+    TASK_CPU,
+    TASK_MEM,
+    TASK_IO,
+    TASK_LOADAVG,
+    TASK_PSI,
+    TASK_NET,
+    TASK_COUNT
+};
+
 enum {
     STATS_CPU,
     STATS_MEM,
@@ -58,6 +127,15 @@ enum {
 #define PROC_MEMINFO   "/proc/meminfo"
 #define PROC_DISKSTATS "/proc/diskstats"
 #define PROC_LOADAVG   "/proc/loadavg"
+#define PROC_NETDEV    "/proc/net/dev"
+
+#define PROC_PRESSURE_CPU    "/proc/pressure/cpu"
+#define PROC_PRESSURE_MEMORY "/proc/pressure/memory"
+#define PROC_PRESSURE_IO     "/proc/pressure/io"
+
+#define TICK_MS       250 // base sampling interval of the meters
+#define SELF_CPU_FULL 1   // percent of a core that fills a self view meter
+#define SCHED_BACKOFF 8   // idle meters slow down to this many ticks
 
 #ifdef SIZE_SMALL
 #  define WIN_WIDTH  60
@@ -109,11 +187,21 @@ enum {
 #define IO_WIDTH   17
 #define IO_HEIGHT  7
 
+#define NET_SRC_X  1
+#define NET_SRC_Y  121
+
+#define ALERT_SRC_Y 114 // stalled variants of the CPU/MEM/IO labels
+
 #define METER_BG_X   32
 #define METER_BG_Y   82
 #define METER_FG_X   1
 #define METER_FG_Y   82
 
+#define METER_SYS_Y    93
+#define METER_IOWAIT_Y 100
+#define METER_STEAL_Y  107
+#define METER_SEGMENTS 4 // most segments a stacked meter has
+
 #ifdef SIZE_SMALL
 #  define METER_WIDTH  26
 #  define METER_HEIGHT 7
@@ -137,6 +225,23 @@ enum {
 #  define SPACER_HEIGHT 1
 #endif
 
+#define HEAT_SRC_X      1
+#define HEAT_SRC_Y      92
+#define HEAT_LEVELS     7
+#define HEAT_CELL_WIDTH 3
+#define HEAT_CELL_STEP  4
+#define HEAT_HEIGHT     1
+
+#ifdef SIZE_SMALL
+#  define HEAT_DST_X 6
+#  define HEAT_DST_Y 25
+#  define HEAT_CELLS 12
+#else
+#  define HEAT_DST_X 6
+#  define HEAT_DST_Y 35
+#  define HEAT_CELLS 13
+#endif
+
 #define LOADAVG_WIDTH    1
 #define LOADAVG_INTERVAL 10
 
@@ -154,6 +259,61 @@ enum {
 #  define LOADAVG_HEIGHT   19
 #endif
 
+// untouched background column right of the graph, clears a column in one copy
+#define LOADAVG_CLEAR_X (LOADAVG_DST_X + LOAD_HIST_LEN)
+
+// orange pixel of the stacked meter sprite, marks a period's peak
+#define HIST_PEAK_SRC_X 1
+#define HIST_PEAK_SRC_Y METER_SYS_Y
+
+// clickable areas, see AddMouseRegion
+enum {
+    REGION_CPU,
+    REGION_MEM,
+    REGION_IO,
+    REGION_GRAPH
+};
+
+typedef struct {
+    long long stamp; // CLOCK_MONOTONIC milliseconds
+    int task;        // TASK_*, selects the member below
+    union {
+        struct {
+            int total;                      // percent busy
+            int amounts[4];                 // user, sys, iowait, steal percent
+            unsigned char heat[HEAT_CELLS]; // shade of the busiest cores
+            proc_stat_t fields;             // host counters as read
+            long int ctxtRate;
+            long int forkRate;
+        } cpu;
+        struct {
+            int percent;                    // used, of the limit in cgroup mode
+            long long used;                 // bytes
+            long long total;
+            long long available;
+            long long swapTotal;
+            long long swapFree;
+        } mem;
+        struct {
+            int percent;                    // of peak, -1 while warming up
+            int bytes;                      // counter is cgroup bytes, not disk ms
+            long long counter;
+        } io;
+        struct {
+            int amounts[2];                 // rx, tx percent of peak, -1 while warming up
+            unsigned long long rx;          // bytes
+            unsigned long long tx;
+        } net;
+        float loadavg[3];
+        struct {
+            long long stallEnd[PSI_COUNT];  // labels stay lit until then
+            float avg10[PSI_COUNT];         // -1 when unavailable
+        } pressure;
+    };
+} sample_t;
+
+#define METER_PIXELS(amount) (CLAMP(amount, 0, 100)*METER_WIDTH/100)
+
 #define MIN(a, b)  (((a) < (b)) ? (a) : (b))
 #define MAX(a, b)  (((a) > (b)) ? (a) : (b))
 #define ABS(a)	   (((a) < 0) ? -(a) : (a))
@@ -0,0 +1,117 @@
+/*
+    Sysmon.app - system monitoring dockapp for WindowMaker
+    Copyright (C) 2018  David Slusky
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Build step: turn the master XPM into atlas.h, a row-major array of
+ * 0xRRGGBB pixels that createWindow uploads with a single XPutImage, so
+ * startup neither parses the XPM nor allocates its colors one by one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef SIZE_SMALL
+#  include "sysmon-small-master.xpm"
+#  define MASTER_XPM sysmon_small_master_xpm
+#else
+#  include "sysmon-master.xpm"
+#  define MASTER_XPM sysmon_master_xpm
+#endif
+
+#define MAX_COLORS 256
+
+typedef struct {
+    char key[8];
+    unsigned int rgb;
+} color_t;
+
+
+/* ========================================================================
+ = FIND_COLOR
+ =
+ = Look up the color of the cpp characters at pixel
+ ======================================================================= */
+
+static const color_t *findColor(const color_t *colors, int count, const char *pixel, int cpp) {
+    for (int i = 0; i < count; i++)
+        if (!strncmp(colors[i].key, pixel, cpp))
+            return &colors[i];
+
+    return NULL;
+}
+
+
+/* ========================================================================
+ = MAIN
+ ======================================================================= */
+
+int main(void) {
+    char **xpm = MASTER_XPM;
+    color_t colors[MAX_COLORS];
+    int width, height, count, cpp;
+
+    if (sscanf(xpm[0], "%d %d %d %d", &width, &height, &count, &cpp) != 4
+            || count > MAX_COLORS || cpp < 1 || cpp >= (int)sizeof(colors[0].key)) {
+        fprintf(stderr, "xpm2atlas: unsupported XPM header \"%s\"\n", xpm[0]);
+        exit(1);
+    }
+
+    // only "#RRGGBB" colors, the atlas has no transparency
+    for (int i = 0; i < count; i++) {
+        const char *line = xpm[1 + i];
+        const char *value = strstr(line + cpp, "c #");
+
+        if (!value || strlen(value + 3) != 6 || sscanf(value + 3, "%6x", &colors[i].rgb) != 1) {
+            fprintf(stderr, "xpm2atlas: unsupported color \"%s\"\n", line);
+            exit(1);
+        }
+
+        memcpy(colors[i].key, line, cpp);
+    }
+
+    printf("/* generated by xpm2atlas, do not edit */\n\n");
+    printf("#define ATLAS_WIDTH  %d\n", width);
+    printf("#define ATLAS_HEIGHT %d\n\n", height);
+    printf("static const unsigned int atlas_pixels[ATLAS_WIDTH * ATLAS_HEIGHT] = {\n");
+
+    for (int y = 0; y < height; y++) {
+        const char *row = xpm[1 + count + y];
+
+        if ((int)strlen(row) != width * cpp) {
+            fprintf(stderr, "xpm2atlas: row %d is not %d pixels wide\n", y, width);
+            exit(1);
+        }
+
+        for (int x = 0; x < width; x++) {
+            const color_t *color = findColor(colors, count, row + x * cpp, cpp);
+
+            if (!color) {
+                fprintf(stderr, "xpm2atlas: unknown color at %d,%d\n", x, y);
+                exit(1);
+            }
+
+            printf("%s0x%06x,", x % 8 ? " " : "    ", color->rgb);
+            if (x % 8 == 7)
+                printf("\n");
+        }
+    }
+
+    printf("};\n");
+    return 0;
+}
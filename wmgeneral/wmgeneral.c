@@ -33,6 +33,7 @@
  /* X11 Variables */
 /*****************/
 
+Display		*display;
 Window		Root;
 int			screen;
 int			x_fd;
@@ -66,7 +67,7 @@ MOUSE_REGION	mouse_region[MAX_MOUSE_REGION];
 /***********************/
 
 static void GetXPM(XpmIcon *, char **);
-static Pixel GetColor(char *);
+static int GetAtlas(XpmIcon *, const XpmAtlas *);
 void RedrawWindow(void);
 void RedrawRegion(int x, int y, int width, int height);
 void AddMouseRegion(int, int, int, int, int);
@@ -110,12 +111,8 @@ void parse_rcfile(const char *filename, rckeys *keys) {
 
 static void GetXPM(XpmIcon *wmgen, char *pixmap_bytes[]) {
 
-	XWindowAttributes	attributes;
 	int					err;
 
-	/* For the colormap */
-	XGetWindowAttributes(display, Root, &attributes);
-
 	wmgen->attributes.valuemask |= (XpmReturnPixels | XpmReturnExtensions);
 
 	err = XpmCreatePixmapFromData(display, Root, pixmap_bytes, &(wmgen->pixmap),
@@ -128,23 +125,92 @@ static void GetXPM(XpmIcon *wmgen, char *pixmap_bytes[]) {
 }
 
 /*******************************************************************************\
-|* GetColor																	   *|
+|* AtlasChannel																   *|
 \*******************************************************************************/
 
-static Pixel GetColor(char *name) {
+static unsigned long AtlasChannel(unsigned int value, unsigned long mask) {
 
-	XColor				color;
-	XWindowAttributes	attributes;
+	int		shift = 0;
+	int		bits = 0;
 
-	XGetWindowAttributes(display, Root, &attributes);
+	while (!(mask & 1)) {
+		mask >>= 1;
+		shift++;
+	}
+	while (mask & 1) {
+		mask >>= 1;
+		bits++;
+	}
+
+	value &= 0xff;
+	value = bits >= 8 ? value << (bits - 8) : value >> (8 - bits);
+	return (unsigned long)value << shift;
+}
 
-	color.pixel = 0;
-	if (!XParseColor(display, attributes.colormap, name, &color)) {
-		fprintf(stderr, "wm.app: can't parse %s.\n", name);
-	} else if (!XAllocColor(display, attributes.colormap, &color)) {
-		fprintf(stderr, "wm.app: can't allocate %s.\n", name);
+/*******************************************************************************\
+|* GetAtlas																	   *|
+|*																			   *|
+|* Upload a precompiled atlas with one XPutImage. TrueColor pixel values	   *|
+|* follow from the visual masks, so no color is allocated and nothing waits	   *|
+|* for a reply. Returns 0 when the visual needs a colormap, the XPM is used	   *|
+|* then.																	   *|
+\*******************************************************************************/
+
+static int GetAtlas(XpmIcon *wmgen, const XpmAtlas *atlas) {
+
+	Visual	*visual = DefaultVisual(display, screen);
+	XImage	*image;
+	GC		gc;
+	int		x, y;
+	int		direct;
+	int		host = 1;
+
+	if (visual->class != TrueColor || !visual->red_mask || !visual->green_mask || !visual->blue_mask)
+		return 0;
+
+	image = XCreateImage(display, visual, d_depth, ZPixmap, 0, NULL,
+				atlas->width, atlas->height, 32, 0);
+	if (!image)
+		return 0;
+
+	/* Already in the server's layout, send the atlas as it is */
+	direct = image->bits_per_pixel == 32 && image->bytes_per_line == atlas->width * 4
+		&& visual->red_mask == 0xff0000 && visual->green_mask == 0xff00 && visual->blue_mask == 0xff
+		&& image->byte_order == (*(char *)&host ? LSBFirst : MSBFirst);
+
+	if (direct) {
+		image->data = (char *)atlas->pixels;
+	} else {
+		if (!(image->data = malloc(image->bytes_per_line * atlas->height))) {
+			XDestroyImage(image);
+			return 0;
+		}
+
+		for (y=0; y<atlas->height; y++) {
+			for (x=0; x<atlas->width; x++) {
+				unsigned int rgb = atlas->pixels[y * atlas->width + x];
+
+				XPutPixel(image, x, y, AtlasChannel(rgb >> 16, visual->red_mask)
+					| AtlasChannel(rgb >> 8, visual->green_mask)
+					| AtlasChannel(rgb, visual->blue_mask));
+			}
+		}
 	}
-	return color.pixel;
+
+	wmgen->pixmap = XCreatePixmap(display, Root, atlas->width, atlas->height, d_depth);
+	wmgen->mask = None;
+	wmgen->attributes.width = atlas->width;
+	wmgen->attributes.height = atlas->height;
+
+	gc = XCreateGC(display, wmgen->pixmap, 0, NULL);
+	XPutImage(display, wmgen->pixmap, gc, image, 0, 0, 0, 0, atlas->width, atlas->height);
+	XFreeGC(display, gc);
+
+	if (direct)
+		image->data = NULL;
+	XDestroyImage(image);
+
+	return 1;
 }
 
 /*******************************************************************************\
@@ -272,7 +338,7 @@ void setMaskXY(int x, int y) {
 /*******************************************************************************\
 |* openXwindow																   *|
 \*******************************************************************************/
-void openXwindow(int argc, char *argv[], char *pixmap_bytes[], char *pixmask_bits, int pixmask_width, int pixmask_height) {
+void openXwindow(int argc, char *argv[], char *pixmap_bytes[], const XpmAtlas *atlas, char *pixmask_bits, int pixmask_width, int pixmask_height) {
 
 	unsigned int	borderwidth = 1;
 	XClassHint		classHint;
@@ -302,16 +368,18 @@ void openXwindow(int argc, char *argv[], char *pixmap_bytes[], char *pixmask_bit
 	d_depth = DefaultDepth(display, screen);
 	x_fd    = XConnectionNumber(display);
 
-	/* Convert XPM to XImage */
-	GetXPM(&wmgen, pixmap_bytes);
+	/* Upload the atlas, or convert XPM to XImage on colormapped visuals */
+	if (!atlas || !GetAtlas(&wmgen, atlas))
+		GetXPM(&wmgen, pixmap_bytes);
 
 	/* Create a window to hold the stuff */
 	mysizehints.flags = USSize | USPosition;
 	mysizehints.x = 0;
 	mysizehints.y = 0;
 
-	back_pix = GetColor("white");
-	fore_pix = GetColor("black");
+	/* Known from the connection setup, no round trip */
+	back_pix = WhitePixel(display, screen);
+	fore_pix = BlackPixel(display, screen);
 
 	XWMGeometry(display, screen, Geometry, NULL, borderwidth, &mysizehints,
 				&mysizehints.x, &mysizehints.y,&mysizehints.width,&mysizehints.height, &dummy);
@@ -336,8 +404,8 @@ void openXwindow(int argc, char *argv[], char *pixmap_bytes[], char *pixmask_bit
 	classHint.res_class = wname;
 	XSetClassHint(display, win, &classHint);
 
-	XSelectInput(display, win, ButtonPressMask | ExposureMask | ButtonReleaseMask | PointerMotionMask | StructureNotifyMask);
-	XSelectInput(display, iconwin, ButtonPressMask | ExposureMask | ButtonReleaseMask | PointerMotionMask | StructureNotifyMask);
+	XSelectInput(display, win, ButtonPressMask | ExposureMask | ButtonReleaseMask | PointerMotionMask | StructureNotifyMask | VisibilityChangeMask);
+	XSelectInput(display, iconwin, ButtonPressMask | ExposureMask | ButtonReleaseMask | PointerMotionMask | StructureNotifyMask | VisibilityChangeMask);
 
 	if (XStringListToTextProperty(&wname, 1, &name) == 0) {
 		fprintf(stderr, "%s: can't allocate window name\n", wname);
@@ -42,11 +42,21 @@ typedef struct {
 	XpmAttributes	attributes;
 } XpmIcon;
 
+typedef struct {
+	const unsigned int	*pixels;	/* 0xRRGGBB, row major */
+	int					width;
+	int					height;
+} XpmAtlas;
+
   /*******************/
  /* Global variable */
 /*******************/
 
-Display		*display;
+extern Display	*display;
+extern int		x_fd;
+extern Window	iconwin, win;
+extern GC		NormalGC;
+extern XpmIcon	wmgen;
 
   /***********************/
  /* Function Prototypes */
@@ -55,7 +65,7 @@ Display		*display;
 void AddMouseRegion(int index, int left, int top, int right, int bottom);
 int CheckMouseRegion(int x, int y);
 
-void openXwindow(int argc, char *argv[], char **, char *, int, int);
+void openXwindow(int argc, char *argv[], char **, const XpmAtlas *, char *, int, int);
 void RedrawWindow(void);
 void RedrawWindowXY(int x, int y);
 void RedrawRegion(int x, int y, int width, int height);